@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Event.h"
+#include "Latch.h"
+#include "Thread.h"
+
+using Clock=std::chrono::steady_clock;
+
+// Summary of the repetitions of one configuration, times in ns per operation
+struct Result {
+    std::string suite;
+    std::string name;
+    std::string param; // Contention level or mix, e.g. "cs=50"
+    int threads;
+    int repetitions;
+    double median, p10, p90, max, min, mean; // (a p99 would only be the max over a few repetitions)
+};
+
+// Runs warmups then timed repetitions of each configuration, keeping the results
+// - A trial runs the configuration once and returns ns per operation
+// - Each result is printed as a table row as soon as it is measured
+class Harness {
+public:
+    Harness(int warmups, int repetitions, std::ostream& table)
+        : m_warmups(warmups), m_repetitions(repetitions), m_table(table) {}
+
+    template<typename Trial>
+    void Run(const std::string& suite, const std::string& name, int threads, const std::string& param, Trial trial) {
+        for (int i = 0; i < m_warmups; ++i)
+            trial();
+
+        std::vector<double> samples;
+        for (int i = 0; i < m_repetitions; ++i)
+            samples.push_back(trial());
+
+        add(summarize(suite, name, threads, param, samples));
+    }
+
+    const std::vector<Result>& Results() const { return m_results; }
+
+    void WriteCsv(std::ostream& out) const;
+    void WriteJson(std::ostream& out) const;
+
+private:
+    int m_warmups;
+    int m_repetitions;
+    std::ostream& m_table;
+    std::vector<Result> m_results;
+
+    static Result summarize(const std::string& suite, const std::string& name, int threads,
+        const std::string& param, std::vector<double>& samples);
+
+    void add(const Result& result);
+};
+
+// Keeps the compiler from dropping the busy work
+inline void busy_work(int work) {
+    volatile int sink = 0;
+    for (int i = 0; i < work; ++i)
+        sink = sink + i;
+}
+
+// Runs body(id) on num_threads threads started together, returns the seconds
+// from their release until the last one finished (thread creation is not timed)
+template<typename Body>
+double run_threads(int num_threads, Body body) {
+    Latch ready(num_threads);
+    ManualResetEvent go;
+
+    std::vector<std::unique_ptr<Thread<void>>> threads;
+    for (int id = 0; id < num_threads; ++id) {
+        threads.emplace_back(new Thread<void>([id, &ready, &go, &body]() {
+            ready.CountDown();
+            go.Wait();
+            body(id);
+        }));
+    }
+
+    ready.Wait();
+    Clock::time_point start = Clock::now();
+    go.Set();
+    for (auto& thread : threads)
+        thread->Wait();
+    Clock::time_point end = Clock::now();
+
+    threads.clear(); // Joins
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// Thread counts from min_threads to max_threads, doubling (max_threads is always included)
+inline std::vector<int> thread_counts(int min_threads, int max_threads) {
+    std::vector<int> counts;
+    for (int n = min_threads; n < max_threads; n *= 2)
+        counts.push_back(n);
+    counts.push_back(max_threads);
+    return counts;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+// The command line interface,
+// based on examples from-> https://github.com/pfultz2/args
+
+// // Parse command line arguments
+// args::parse<cli>(argc, argv);
+// if (!cli::valid) return 0;
+
+struct cli {
+    static const char* help() {
+        return "Benchmark libthreading primitives";
+    }
+    static const char* name() { return "bench"; }
+
+    static std::string suites;
+    static int min_threads;
+    static int max_threads;
+    static int ops;
+    static int repetitions;
+    static int warmups;
+    static std::string format;
+    static std::string output;
+    static bool valid;
+
+    template<class F>
+    void parse(F f) {
+        f(suites, "--suites", "-s", args::help("Comma separated suites to run: mutex, rwlock, condition, barrier, thread, timer or all. (default=all)"));
+        f(min_threads, "--min_threads", "-t", args::help("The smallest thread count, doubled up to max_threads. (default=1)"));
+        f(max_threads, "--max_threads", "-T", args::help("The largest thread count. (default=0, 128 for the barrier suite and 16 for the others)"));
+        f(ops, "--ops", "-n", args::help("The operations per trial, split over the threads. (default=200000)"));
+        f(repetitions, "--repetitions", "-r", args::help("The timed trials per configuration. (default=7)"));
+        f(warmups, "--warmups", "-w", args::help("The untimed trials before them. (default=1)"));
+        f(format, "--format", "-f", args::help("Also write the results as csv or json. (default=none)"));
+        f(output, "--output", "-o", args::help("The file for --format, - for stdout. (default=-)"));
+    }
+
+    void run() {
+        valid = true;
+
+        if (min_threads < 1) min_threads = 1;
+        if (max_threads < 0) max_threads = 0;
+        if (max_threads && max_threads < min_threads) max_threads = min_threads;
+        if (ops < 1) ops = 1;
+        if (repetitions < 1) repetitions = 1;
+        if (warmups < 0) warmups = 0;
+
+        // Report arguments, for benefit of record keeping
+        std::cout << "Args:\tsuites=" << suites
+            << "\n\tmin_threads=" << min_threads
+            << "\n\tmax_threads=" << max_threads
+            << "\n\tops=" << ops
+            << "\n\trepetitions=" << repetitions
+            << "\n\twarmups=" << warmups
+            << "\n\tformat=" << format
+            << "\n\toutput=" << output << std::endl;
+    }
+};
+
+bool cli::valid = false;
+
+// Default values:
+std::string cli::suites = "all";
+int cli::min_threads = 1;
+int cli::max_threads = 0; // Per suite default
+int cli::ops = 200000;
+int cli::repetitions = 7;
+int cli::warmups = 1;
+std::string cli::format = "none";
+std::string cli::output = "-";
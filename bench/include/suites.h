@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+class Harness;
+
+// Each suite runs every primitive of its kind for each of the thread counts,
+// ops is the total number of operations per trial (split over the threads)
+
+void bench_mutex(Harness& harness, const std::vector<int>& threads, int ops);      // Lock/unlock at high and low contention, two-lock transfers
+void bench_rwlock(Harness& harness, const std::vector<int>& threads, int ops);     // Read/write mixes
+void bench_condition(Harness& harness, int ops);                                   // Two thread ping-pong
+void bench_barrier(Harness& harness, const std::vector<int>& threads, int ops);    // Short phases
+void bench_thread(Harness& harness, const std::vector<int>& threads, int ops);     // Create/join
+void bench_timer(Harness& harness, const std::vector<int>& threads, int ops);      // Schedule/cancel and firing
@@ -0,0 +1,72 @@
+#include "Harness.h"
+
+#include <iomanip>
+
+// Nearest rank percentile of sorted samples
+static double percentile(const std::vector<double>& sorted, double fraction) {
+    size_t rank = (size_t)(fraction*(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+Result Harness::summarize(const std::string& suite, const std::string& name, int threads,
+        const std::string& param, std::vector<double>& samples) {
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0;
+    for (double sample : samples) sum += sample;
+
+    Result result;
+    result.suite = suite;
+    result.name = name;
+    result.param = param;
+    result.threads = threads;
+    result.repetitions = samples.size();
+    result.median = percentile(samples, 0.5);
+    result.p10 = percentile(samples, 0.1);
+    result.p90 = percentile(samples, 0.9);
+    result.max = samples.back();
+    result.min = samples.front();
+    result.mean = sum / samples.size();
+    return result;
+}
+
+void Harness::add(const Result& result) {
+    if (m_results.empty() || m_results.back().suite != result.suite) {
+        m_table << "\n[" << result.suite << "] ns per op\n"
+            << std::left << std::setw(24) << "name" << std::setw(12) << "param" << std::right
+            << std::setw(8) << "threads" << std::setw(12) << "median"
+            << std::setw(12) << "p10" << std::setw(12) << "p90" << std::setw(12) << "max" << std::endl;
+    }
+
+    std::streamsize precision = m_table.precision();
+    m_table << std::left << std::setw(24) << result.name << std::setw(12) << result.param << std::right
+        << std::setw(8) << result.threads << std::fixed << std::setprecision(1)
+        << std::setw(12) << result.median << std::setw(12) << result.p10
+        << std::setw(12) << result.p90 << std::setw(12) << result.max
+        << std::defaultfloat << std::setprecision(precision) << std::endl;
+
+    m_results.push_back(result);
+}
+
+void Harness::WriteCsv(std::ostream& out) const {
+    out << std::fixed << std::setprecision(1);
+    out << "suite,name,param,threads,repetitions,median_ns,p10_ns,p90_ns,max_ns,min_ns,mean_ns\n";
+    for (const Result& r : m_results) {
+        out << r.suite << "," << r.name << "," << r.param << "," << r.threads << "," << r.repetitions
+            << "," << r.median << "," << r.p10 << "," << r.p90 << "," << r.max << "," << r.min << "," << r.mean << "\n";
+    }
+}
+
+void Harness::WriteJson(std::ostream& out) const {
+    out << std::fixed << std::setprecision(1);
+    out << "[";
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        const Result& r = m_results[i];
+        out << (i ? ",\n " : "\n ")
+            << "{\"suite\":\"" << r.suite << "\",\"name\":\"" << r.name << "\",\"param\":\"" << r.param
+            << "\",\"threads\":" << r.threads << ",\"repetitions\":" << r.repetitions
+            << ",\"median_ns\":" << r.median << ",\"p10_ns\":" << r.p10 << ",\"p90_ns\":" << r.p90
+            << ",\"max_ns\":" << r.max << ",\"min_ns\":" << r.min << ",\"mean_ns\":" << r.mean << "}";
+    }
+    out << "\n]\n";
+}
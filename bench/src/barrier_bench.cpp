@@ -0,0 +1,38 @@
+#include "suites.h"
+
+#include "Barrier.h"
+#include "Harness.h"
+
+static const int s_work = 100; // Busy work per thread between phases
+
+// ns per phase
+template<typename Wait>
+static double trial(int threads, int phases, Wait wait) {
+    double seconds = run_threads(threads, [&](int id) {
+        for (int p = 0; p < phases; ++p) {
+            busy_work(s_work);
+            wait(id);
+        }
+    });
+    return seconds*1e9 / phases;
+}
+
+void bench_barrier(Harness& harness, const std::vector<int>& threads, int ops) {
+    for (int n : threads) {
+        if (n < 2) continue;
+        int phases = std::max(100, ops / (10*n));
+
+        harness.Run("barrier", "Barrier", n, "work=100", [&]() {
+            Barrier barrier(n);
+            return trial(n, phases, [&barrier](int) { barrier.Wait(); });
+        });
+        harness.Run("barrier", "SpinBarrier", n, "work=100", [&]() {
+            SpinBarrier barrier(n);
+            return trial(n, phases, [&barrier](int) { barrier.Wait(); });
+        });
+        harness.Run("barrier", "TreeBarrier", n, "work=100", [&]() {
+            TreeBarrier barrier(n);
+            return trial(n, phases, [&barrier](int id) { barrier.Wait(id); });
+        });
+    }
+}
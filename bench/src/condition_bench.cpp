@@ -0,0 +1,48 @@
+#include "suites.h"
+
+#include "Condition.h"
+#include "Event.h"
+#include "Harness.h"
+#include "Mutex.h"
+
+// Two threads hand a turn back and forth, ns per round trip
+template<typename Lock, typename Guard>
+static double condition_trial(int rounds) {
+    Lock lock;
+    Condition turned;
+    int turn = 0;
+
+    double seconds = run_threads(2, [&](int id) {
+        for (int i = 0; i < rounds; ++i) {
+            Guard guard(lock);
+            while (turn != id) turned.Wait(lock);
+            turn = 1 - id;
+            turned.Signal();
+        }
+    });
+    return seconds*1e9 / rounds;
+}
+
+static double event_trial(int rounds) {
+    AutoResetEvent ping, pong;
+
+    double seconds = run_threads(2, [&](int id) {
+        for (int i = 0; i < rounds; ++i) {
+            if (id == 0) {
+                ping.Set();
+                pong.Wait();
+            } else {
+                ping.Wait();
+                pong.Set();
+            }
+        }
+    });
+    return seconds*1e9 / rounds;
+}
+
+void bench_condition(Harness& harness, int ops) {
+    int rounds = std::max(1, ops / 10); // Every round trip sleeps twice
+    harness.Run("condition", "Condition(Mutex)", 2, "ping-pong", [&]() { return condition_trial<Mutex, ScopedMutex>(rounds); });
+    harness.Run("condition", "Condition(FutexMutex)", 2, "ping-pong", [&]() { return condition_trial<FutexMutex, ScopedFutexMutex>(rounds); });
+    harness.Run("condition", "AutoResetEvent", 2, "ping-pong", [&]() { return event_trial(rounds); });
+}
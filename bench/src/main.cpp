@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <args.hpp>
+#include "cli.h"
+
+#include "Core.h"
+#include "Harness.h"
+#include "suites.h"
+
+// Is suite listed in the comma separated list (or is the list "all")?
+bool selected(const std::string& list, const std::string& suite);
+
+int main(int argc, char const *argv[]) {
+    args::parse<cli>(argc, argv);
+    if (!cli::valid) return 0;
+
+    Core::Init();
+    std::cout << "avail threads: " << Core::Count() << std::endl;
+
+    Harness harness(cli::warmups, cli::repetitions, std::cout);
+    // Barriers are compared up to many more threads than there are CPUs
+    std::vector<int> threads = thread_counts(cli::min_threads,
+        cli::max_threads ? cli::max_threads : std::max(cli::min_threads, 16));
+    std::vector<int> barrier_threads = thread_counts(cli::min_threads,
+        cli::max_threads ? cli::max_threads : std::max(cli::min_threads, 128));
+
+    if (selected(cli::suites, "mutex")) bench_mutex(harness, threads, cli::ops);
+    if (selected(cli::suites, "rwlock")) bench_rwlock(harness, threads, cli::ops);
+    if (selected(cli::suites, "condition")) bench_condition(harness, cli::ops);
+    if (selected(cli::suites, "barrier")) bench_barrier(harness, barrier_threads, cli::ops);
+    if (selected(cli::suites, "thread")) bench_thread(harness, threads, cli::ops);
+    if (selected(cli::suites, "timer")) bench_timer(harness, threads, cli::ops);
+
+    if (cli::format == "csv" || cli::format == "json") {
+        std::ofstream file;
+        if (cli::output != "-") file.open(cli::output);
+        std::ostream& out = file.is_open() ? file : std::cout;
+
+        if (&out == &std::cout) std::cout << std::endl;
+        if (cli::format == "csv") harness.WriteCsv(out);
+        else harness.WriteJson(out);
+    }
+
+    return 0;
+}
+
+bool selected(const std::string& list, const std::string& suite) {
+    std::istringstream names(list);
+    std::string name;
+    while (std::getline(names, name, ','))
+        if (name == "all" || name == suite) return true;
+    return false;
+}
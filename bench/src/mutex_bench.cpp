@@ -0,0 +1,119 @@
+#include "suites.h"
+
+#include <cassert>
+#include <cstdint>
+
+#include "Harness.h"
+#include "MultiLock.h"
+#include "Mutex.h"
+
+// Work inside and outside the critical section, per contention level
+struct Contention {
+    const char* name;
+    int inside;
+    int outside;
+};
+
+static const Contention s_levels[] = {
+    { "high", 20, 0 },
+    { "low", 20, 2000 },
+};
+
+// ns per lock/unlock pair, over all threads
+template<typename Lock, typename Locked>
+static double trial(int threads, int ops, const Contention& level, Locked locked) {
+    Lock lock;
+    int per_thread = std::max(1, ops / threads);
+    double seconds = run_threads(threads, [&](int) {
+        for (int i = 0; i < per_thread; ++i) {
+            locked(lock, level.inside);
+            busy_work(level.outside);
+        }
+    });
+    return seconds*1e9 / (per_thread*threads);
+}
+
+// Moves between random pairs of accounts, each behind its own lock
+struct Account {
+    Mutex lock;
+    long balance = 0;
+};
+
+static const int NumAccounts = 16;
+
+// ns per transfer, over all threads
+template<typename Transfer>
+static double transfers(int threads, int ops, Transfer transfer) {
+    Account accounts[NumAccounts];
+    int per_thread = std::max(1, ops / threads);
+    double seconds = run_threads(threads, [&](int id) {
+        uint32_t seed = 2654435761u*(id + 1);
+        for (int i = 0; i < per_thread; ++i) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            int from = seed % NumAccounts;
+            int to = (from + 1 + (seed >> 16) % (NumAccounts - 1)) % NumAccounts;
+            transfer(accounts[from], accounts[to]);
+        }
+    });
+
+    // Every transfer moved one unit, so a lost update shows as a nonzero total
+    long total = 0;
+    for (const Account& account : accounts)
+        total += account.balance;
+    assert(total == 0);
+    (void)total;
+
+    return seconds*1e9 / (per_thread*threads);
+}
+
+void bench_mutex(Harness& harness, const std::vector<int>& threads, int ops) {
+    for (const Contention& level : s_levels) {
+        for (int n : threads) {
+            harness.Run("mutex", "Mutex", n, level.name, [&]() {
+                return trial<Mutex>(n, ops, level, [](Mutex& lock, int work) {
+                    lock.Lock();
+                    busy_work(work);
+                    lock.Unlock();
+                });
+            });
+            harness.Run("mutex", "ScopedMutex", n, level.name, [&]() {
+                return trial<Mutex>(n, ops, level, [](Mutex& lock, int work) {
+                    ScopedMutex guard(lock);
+                    busy_work(work);
+                });
+            });
+            harness.Run("mutex", "FutexMutex", n, level.name, [&]() {
+                return trial<FutexMutex>(n, ops, level, [](FutexMutex& lock, int work) {
+                    lock.Lock();
+                    busy_work(work);
+                    lock.Unlock();
+                });
+            });
+            harness.Run("mutex", "ScopedFutexMutex", n, level.name, [&]() {
+                return trial<FutexMutex>(n, ops, level, [](FutexMutex& lock, int work) {
+                    ScopedFutexMutex guard(lock);
+                    busy_work(work);
+                });
+            });
+        }
+    }
+
+    for (int n : threads) {
+        harness.Run("mutex", "MultiLock(address)", n, "transfer", [&]() {
+            return transfers(n, ops, [](Account& from, Account& to) {
+                ScopedMultiLock guard(from.lock, to.lock);
+                --from.balance;
+                ++to.balance;
+            });
+        });
+        harness.Run("mutex", "MultiLock(backoff)", n, "transfer", [&]() {
+            return transfers(n, ops, [](Account& from, Account& to) {
+                ScopedMultiLock guard(LockOrder::Backoff, from.lock, to.lock);
+                --from.balance;
+                ++to.balance;
+            });
+        });
+    }
+}
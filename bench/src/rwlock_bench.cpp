@@ -0,0 +1,66 @@
+#include "suites.h"
+
+#include <cstdint>
+#include <string>
+
+#include "DistributedRWLock.h"
+#include "Harness.h"
+#include "RWLock.h"
+
+static const int s_readPercents[] = { 50, 90, 99 };
+
+// Cheap per thread random numbers, so the mix does not depend on a shared generator
+static inline uint32_t xorshift(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// ns per read or write, over all threads
+template<typename Lock, typename Read, typename Write>
+static double trial(int threads, int ops, int read_percent, Read read, Write write) {
+    Lock lock;
+    long shared[8] = {};
+    int per_thread = std::max(1, ops / threads);
+    double seconds = run_threads(threads, [&](int id) {
+        uint32_t state = 2463534242u + id;
+        for (int i = 0; i < per_thread; ++i) {
+            if ((int)(xorshift(state) % 100) < read_percent) read(lock, shared);
+            else write(lock, shared);
+        }
+    });
+    return seconds*1e9 / (per_thread*threads);
+}
+
+void bench_rwlock(Harness& harness, const std::vector<int>& threads, int ops) {
+    for (int read_percent : s_readPercents) {
+        std::string mix = "read=" + std::to_string(read_percent) + "%";
+        for (int n : threads) {
+            harness.Run("rwlock", "RWLock", n, mix, [&]() {
+                return trial<RWLock>(n, ops, read_percent,
+                    [](RWLock& lock, long* shared) {
+                        ScopedReadLock guard(lock);
+                        volatile long sum = shared[0] + shared[7];
+                        (void)sum;
+                    },
+                    [](RWLock& lock, long* shared) {
+                        ScopedWriteLock guard(lock);
+                        for (int i = 0; i < 8; ++i) ++shared[i];
+                    });
+            });
+            harness.Run("rwlock", "DistributedRWLock", n, mix, [&]() {
+                return trial<DistributedRWLock>(n, ops, read_percent,
+                    [](DistributedRWLock& lock, long* shared) {
+                        ScopedDistributedReadLock guard(lock);
+                        volatile long sum = shared[0] + shared[7];
+                        (void)sum;
+                    },
+                    [](DistributedRWLock& lock, long* shared) {
+                        ScopedDistributedWriteLock guard(lock);
+                        for (int i = 0; i < 8; ++i) ++shared[i];
+                    });
+            });
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#include "suites.h"
+
+#include <pthread.h>
+
+#include "Harness.h"
+#include "Thread.h"
+
+static void* noop(void* arg) { return arg; }
+
+// Starts batches of threads threads then joins them, ns per thread
+template<typename Batch>
+static double trial(int threads, int total, Batch batch) {
+    int batches = std::max(1, total / threads);
+    Clock::time_point start = Clock::now();
+    for (int b = 0; b < batches; ++b)
+        batch(threads);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return seconds*1e9 / (batches*threads);
+}
+
+void bench_thread(Harness& harness, const std::vector<int>& threads, int ops) {
+    int total = std::max(1, ops / 1000); // Creating a thread costs ~1000 lock operations
+
+    for (int n : threads) {
+        harness.Run("thread", "pthread_create", n, "create/join", [&]() {
+            return trial(n, total, [](int count) {
+                std::vector<pthread_t> handles(count);
+                for (pthread_t& handle : handles)
+                    pthread_create(&handle, nullptr, noop, nullptr);
+                for (pthread_t& handle : handles)
+                    pthread_join(handle, nullptr);
+            });
+        });
+        harness.Run("thread", "Thread<void>", n, "create/join", [&]() {
+            return trial(n, total, [](int count) {
+                std::vector<std::unique_ptr<Thread<void>>> batch;
+                for (int i = 0; i < count; ++i)
+                    batch.emplace_back(new Thread<void>([]() {}));
+                batch.clear(); // Joins
+            });
+        });
+        harness.Run("thread", "Thread<void> 64K", n, "create/join", [&]() {
+            return trial(n, total, [](int count) {
+                std::vector<std::unique_ptr<Thread<void>>> batch;
+                for (int i = 0; i < count; ++i)
+                    batch.emplace_back(new Thread<void>(ThreadAttr().StackSize(64*1024), []() {}));
+                batch.clear(); // Joins, returning the stacks to the StackCache
+            });
+        });
+    }
+}
@@ -0,0 +1,45 @@
+#include "suites.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include "Harness.h"
+#include "Latch.h"
+#include "TimerWheel.h"
+
+// Every thread schedules a far timer and cancels it again, ns per pair
+static double cancel_trial(TimerWheel& wheel, int threads, int ops) {
+    int per_thread = std::max(1, ops / threads);
+    double seconds = run_threads(threads, [&](int) {
+        for (int i = 0; i < per_thread; ++i) {
+            TimerWheel::TimerId id = wheel.After(std::chrono::seconds(10), []() {});
+            wheel.Cancel(id);
+        }
+    });
+    return seconds*1e9 / (per_thread*threads);
+}
+
+// Every thread schedules timers due within a few ms, ns per timer until all have fired
+static double fire_trial(TimerWheel& wheel, int threads, int ops) {
+    int per_thread = std::max(1, ops / threads);
+    // Shared, the last callback may still be counting down after we wake
+    auto fired = std::make_shared<Latch>(per_thread*threads);
+
+    Clock::time_point start = Clock::now();
+    run_threads(threads, [&](int id) {
+        for (int i = 0; i < per_thread; ++i)
+            wheel.After(std::chrono::microseconds(1000 + (i + id) % 4000), [fired]() { fired->CountDown(); });
+    });
+    fired->Wait();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return seconds*1e9 / (per_thread*threads);
+}
+
+void bench_timer(Harness& harness, const std::vector<int>& threads, int ops) {
+    TimerWheel wheel;
+    for (int n : threads) {
+        harness.Run("timer", "TimerWheel", n, "after/cancel", [&]() { return cancel_trial(wheel, n, ops); });
+        harness.Run("timer", "TimerWheel", n, "fire", [&]() { return fire_trial(wheel, n, ops); });
+    }
+}
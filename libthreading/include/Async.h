@@ -0,0 +1,416 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Async.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+// Coroutine counterparts of Mutex, Condition and Channel (see Coroutine.h),
+// compiled in only with LIBTHREADING_COROUTINES
+#ifdef LIBTHREADING_COROUTINES
+
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <utility>
+
+#include "Coroutine.h"
+#include "Mutex.h"
+
+// A coroutine suspended in one of the primitives below
+// - Lives in the suspended coroutine's frame, so parking needs no allocation
+struct AsyncWaiter {
+    std::coroutine_handle<> handle;
+    Executor* executor = nullptr; // Where to resume (nullptr resumes on the waking thread)
+    AsyncWaiter* next = nullptr;
+
+    void Park(std::coroutine_handle<> suspended) {
+        handle = suspended;
+        executor = Executor::Current();
+    }
+
+    void Resume() {
+        if (executor) executor->Schedule(handle);
+        else handle.resume();
+    }
+};
+
+// Intrusive FIFO of AsyncWaiters
+class AsyncWaitList {
+public:
+    inline bool Empty() const { return !m_head; }
+
+    void Push(AsyncWaiter* waiter) {
+        waiter->next = nullptr;
+        if (m_tail) m_tail->next = waiter;
+        else m_head = waiter;
+        m_tail = waiter;
+    }
+
+    // The longest waiting, or nullptr if empty
+    AsyncWaiter* Pop() {
+        AsyncWaiter* waiter = m_head;
+        if (waiter) {
+            m_head = waiter->next;
+            if (!m_head) m_tail = nullptr;
+        }
+        return waiter;
+    }
+
+private:
+    AsyncWaiter* m_head = nullptr;
+    AsyncWaiter* m_tail = nullptr;
+};
+
+class ScopedAsyncMutex;
+
+// Mutex that suspends the awaiting coroutine instead of blocking its worker, e.g.
+//      ScopedAsyncMutex guard = co_await mutex.ScopedLock();
+// - Unlock() hands the lock straight to the longest waiter (FIFO, no barging)
+// - Its own state is guarded by a FutexMutex held for a few instructions only
+class AsyncMutex {
+public:
+    AsyncMutex() = default;
+    AsyncMutex(const AsyncMutex&) = delete;
+    AsyncMutex& operator=(const AsyncMutex&) = delete;
+
+    // co_await mutex.Lock()
+    class LockAwaiter : public AsyncWaiter {
+    public:
+        LockAwaiter(AsyncMutex& mutex) : m_mutex(mutex) {}
+
+        bool await_ready() noexcept { return m_mutex.TryLock(); }
+
+        bool await_suspend(std::coroutine_handle<> suspended) noexcept {
+            Park(suspended);
+            return !m_mutex.acquireOrQueue(this);
+        }
+
+        void await_resume() noexcept {}
+
+    protected:
+        AsyncMutex& m_mutex;
+    };
+
+    // co_await mutex.ScopedLock(), unlocking when the returned guard goes out of scope
+    class ScopedLockAwaiter : public LockAwaiter {
+    public:
+        using LockAwaiter::LockAwaiter;
+        ScopedAsyncMutex await_resume() noexcept;
+    };
+
+    LockAwaiter Lock() { return LockAwaiter(*this); }
+    ScopedLockAwaiter ScopedLock() { return ScopedLockAwaiter(*this); }
+
+    bool TryLock() {
+        ScopedFutexMutex guard(m_lock);
+        if (m_locked) return false;
+        m_locked = true;
+        return true;
+    }
+
+    void Unlock() {
+        AsyncWaiter* next;
+        {
+            ScopedFutexMutex guard(m_lock);
+            assert(m_locked);
+            next = m_waiters.Pop();
+            if (!next) m_locked = false;
+        }
+        if (next) next->Resume(); // It now holds the lock
+    }
+
+private:
+    friend class AsyncCondition;
+
+    FutexMutex m_lock;
+    bool m_locked = false;
+    AsyncWaitList m_waiters;
+
+    // Take the lock for waiter (returns true), or queue it to be handed the lock
+    bool acquireOrQueue(AsyncWaiter* waiter) {
+        ScopedFutexMutex guard(m_lock);
+        if (!m_locked) {
+            m_locked = true;
+            return true;
+        }
+        m_waiters.Push(waiter);
+        return false;
+    }
+};
+
+// Unlocks an AsyncMutex on scope exit
+class ScopedAsyncMutex {
+public:
+    explicit ScopedAsyncMutex(AsyncMutex& lock) : m_lock(&lock) {}
+    ScopedAsyncMutex(ScopedAsyncMutex&& other) noexcept : m_lock(std::exchange(other.m_lock, nullptr)) {}
+    ~ScopedAsyncMutex() { if (m_lock) m_lock->Unlock(); }
+
+    ScopedAsyncMutex(const ScopedAsyncMutex&) = delete;
+    ScopedAsyncMutex& operator=(const ScopedAsyncMutex&) = delete;
+
+private:
+    AsyncMutex* m_lock;
+};
+
+inline ScopedAsyncMutex AsyncMutex::ScopedLockAwaiter::await_resume() noexcept { return ScopedAsyncMutex(m_mutex); }
+
+// Condition variable for coroutines holding an AsyncMutex, e.g.
+//      auto guard = co_await mutex.ScopedLock();
+//      while (!ready) co_await condition.Wait(mutex);
+// - A signalled waiter is queued on the mutex directly, so it resumes holding it
+class AsyncCondition {
+public:
+    AsyncCondition() = default;
+    AsyncCondition(const AsyncCondition&) = delete;
+    AsyncCondition& operator=(const AsyncCondition&) = delete;
+
+    // co_await condition.Wait(mutex): unlock mutex, suspend until signalled, then relock it
+    class WaitAwaiter : public AsyncWaiter {
+    public:
+        WaitAwaiter(AsyncCondition& condition, AsyncMutex& mutex)
+            : m_condition(condition), m_mutex(mutex) {}
+
+        bool await_ready() noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> suspended) noexcept {
+            Park(suspended);
+            // Once queued a signal may resume us elsewhere, so copy what we still need
+            AsyncMutex& mutex = m_mutex;
+            {
+                ScopedFutexMutex guard(m_condition.m_lock);
+                m_condition.m_waiters.Push(this);
+            }
+            mutex.Unlock();
+        }
+
+        void await_resume() noexcept {}
+
+    private:
+        friend AsyncCondition;
+
+        AsyncCondition& m_condition;
+        AsyncMutex& m_mutex;
+    };
+
+    WaitAwaiter Wait(AsyncMutex& mutex) { return WaitAwaiter(*this, mutex); }
+
+    // Wake the longest waiter, if any
+    void Signal() {
+        AsyncWaiter* waiter;
+        {
+            ScopedFutexMutex guard(m_lock);
+            waiter = m_waiters.Pop();
+        }
+        if (waiter) requeue(static_cast<WaitAwaiter*>(waiter));
+    }
+
+    // Wake every waiter
+    void Broadcast() {
+        AsyncWaitList waiters;
+        {
+            ScopedFutexMutex guard(m_lock);
+            std::swap(waiters, m_waiters);
+        }
+        while (AsyncWaiter* waiter = waiters.Pop())
+            requeue(static_cast<WaitAwaiter*>(waiter));
+    }
+
+private:
+    FutexMutex m_lock;
+    AsyncWaitList m_waiters;
+
+    // Resume waiter once it holds its mutex again
+    static void requeue(WaitAwaiter* waiter) {
+        if (waiter->m_mutex.acquireOrQueue(waiter)) waiter->Resume();
+    }
+};
+
+// Bounded queue for coroutines
+// - co_await Push(item) suspends while full, co_await Pop() suspends while empty
+// - Items are handed straight to a suspended popper, and a suspended pusher's item
+//   straight into the freed slot, so every resumed coroutine's operation is complete
+// - Capacity 0 makes every Push() wait for a Pop() (rendezvous)
+// - Close() resumes everyone, then Push() fails and Pop() fails once drained
+template<typename T>
+class AsyncChannel {
+public:
+    AsyncChannel(size_t capacity) : m_capacity(capacity) {}
+
+    AsyncChannel(const AsyncChannel&) = delete;
+    AsyncChannel& operator=(const AsyncChannel&) = delete;
+
+    inline size_t Capacity() const { return m_capacity; }
+
+    // co_await channel.Push(item), true unless the channel is closed
+    class PushAwaiter : public AsyncWaiter {
+    public:
+        PushAwaiter(AsyncChannel& channel, T item) : m_channel(channel), m_item(std::move(item)) {}
+
+        bool await_ready() noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> suspended) {
+            Park(suspended);
+            return m_channel.pushOrQueue(this);
+        }
+
+        bool await_resume() noexcept { return m_pushed; }
+
+    private:
+        friend AsyncChannel;
+
+        AsyncChannel& m_channel;
+        T m_item;
+        bool m_pushed = false;
+    };
+
+    // co_await channel.Pop(), empty once the channel is closed and drained
+    class PopAwaiter : public AsyncWaiter {
+    public:
+        PopAwaiter(AsyncChannel& channel) : m_channel(channel) {}
+
+        bool await_ready() noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> suspended) {
+            Park(suspended);
+            return m_channel.popOrQueue(this);
+        }
+
+        std::optional<T> await_resume() { return std::move(m_item); }
+
+    private:
+        friend AsyncChannel;
+
+        AsyncChannel& m_channel;
+        std::optional<T> m_item;
+    };
+
+    PushAwaiter Push(T item) { return PushAwaiter(*this, std::move(item)); }
+    PopAwaiter Pop() { return PopAwaiter(*this); }
+
+    // Add item without suspending (e.g. from a plain thread), returns false if full or closed
+    bool TryPush(T item) {
+        AsyncWaiter* popper = nullptr;
+        {
+            ScopedFutexMutex guard(m_lock);
+            if (m_closed) return false;
+            if (!m_poppers.Empty()) {
+                popper = handOff(std::move(item));
+            } else if (m_items.size() < m_capacity) {
+                m_items.push_back(std::move(item));
+            } else {
+                return false;
+            }
+        }
+        if (popper) popper->Resume();
+        return true;
+    }
+
+    // Take the oldest item without suspending, returns false if empty
+    bool TryPop(T& item) {
+        AsyncWaiter* pusher = nullptr;
+        {
+            ScopedFutexMutex guard(m_lock);
+            std::optional<T> taken = take(pusher);
+            if (!taken) return false;
+            item = std::move(*taken);
+        }
+        if (pusher) pusher->Resume();
+        return true;
+    }
+
+    void Close() {
+        AsyncWaitList pushers, poppers;
+        {
+            ScopedFutexMutex guard(m_lock);
+            m_closed = true;
+            std::swap(pushers, m_pushers);
+            std::swap(poppers, m_poppers);
+        }
+        // Their results are already false/empty
+        while (AsyncWaiter* waiter = pushers.Pop()) waiter->Resume();
+        while (AsyncWaiter* waiter = poppers.Pop()) waiter->Resume();
+    }
+
+    bool Closed() {
+        ScopedFutexMutex guard(m_lock);
+        return m_closed;
+    }
+
+    size_t Size() {
+        ScopedFutexMutex guard(m_lock);
+        return m_items.size();
+    }
+
+private:
+    const size_t m_capacity;
+    FutexMutex m_lock;
+    std::deque<T> m_items;
+    AsyncWaitList m_pushers; // Only waiting while full
+    AsyncWaitList m_poppers; // Only waiting while empty
+    bool m_closed = false;
+
+    // Give item to the longest waiting popper, returning it to be resumed
+    AsyncWaiter* handOff(T&& item) {
+        PopAwaiter* popper = static_cast<PopAwaiter*>(m_poppers.Pop());
+        popper->m_item.emplace(std::move(item));
+        return popper;
+    }
+
+    // The oldest item (or a rendezvous pusher's), refilling from a waiting pusher
+    // - Sets pusher to the pusher to resume, if any
+    std::optional<T> take(AsyncWaiter*& pusher) {
+        std::optional<T> item;
+        PushAwaiter* waiting = static_cast<PushAwaiter*>(m_pushers.Pop());
+        if (!m_items.empty()) {
+            item.emplace(std::move(m_items.front()));
+            m_items.pop_front();
+            if (waiting) m_items.push_back(std::move(waiting->m_item));
+        } else if (waiting) {
+            item.emplace(std::move(waiting->m_item));
+        }
+        if (waiting) waiting->m_pushed = true;
+        pusher = waiting;
+        return item;
+    }
+
+    // Complete pusher's push (returns false) or queue it until there is room (returns true)
+    bool pushOrQueue(PushAwaiter* pusher) {
+        AsyncWaiter* popper = nullptr;
+        {
+            ScopedFutexMutex guard(m_lock);
+            if (m_closed) return false;
+            if (!m_poppers.Empty()) {
+                popper = handOff(std::move(pusher->m_item));
+            } else if (m_items.size() < m_capacity) {
+                m_items.push_back(std::move(pusher->m_item));
+            } else {
+                m_pushers.Push(pusher);
+                return true;
+            }
+            pusher->m_pushed = true;
+        }
+        if (popper) popper->Resume();
+        return false;
+    }
+
+    // Complete popper's pop (returns false) or queue it until there is an item (returns true)
+    bool popOrQueue(PopAwaiter* popper) {
+        AsyncWaiter* pusher = nullptr;
+        {
+            ScopedFutexMutex guard(m_lock);
+            popper->m_item = take(pusher);
+            if (!popper->m_item && !m_closed) {
+                m_poppers.Push(popper);
+                return true;
+            }
+        }
+        if (pusher) pusher->Resume();
+        return false;
+    }
+};
+
+#endif
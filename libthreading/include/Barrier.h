@@ -6,9 +6,15 @@
 ==============================================================================*/
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <pthread.h>
 
+#include "Core.h"
+#include "Futex.h"
+#include "PerCore.h"
+
 // Wraps pthread_barrier_t for convenience
 class Barrier {
 public:
@@ -24,3 +30,154 @@ public:
 private:
     pthread_barrier_t m_barrier;
 };
+
+// Phase number that waiters spin on, then sleep on as a futex word
+// (the release half shared by SpinBarrier and TreeBarrier)
+class BarrierPhase {
+public:
+    static const int DefaultSpins = 4000;
+
+    // Spinning only pays off while every party has a CPU of its own
+    // (requires Core::Init(), else spins is taken as is)
+    BarrierPhase(int count, int spins)
+        : m_spins((Core::Count() && count > (int)Core::Count()) ? 0 : spins) {}
+
+    inline int Current() { return m_phase.load(std::memory_order_acquire); }
+
+    // Wait until the phase moves past seen
+    void Await(int seen) {
+        for (int i = 0; i < m_spins; ++i) {
+            if (m_phase.load(std::memory_order_acquire) != seen) return;
+            CpuRelax();
+        }
+
+        m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        while (m_phase.load(std::memory_order_seq_cst) == seen)
+            Futex::Wait(&m_phase, seen);
+        m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Release everyone waiting on the current phase, without a syscall unless some sleep
+    void Advance() {
+        m_phase.fetch_add(1, std::memory_order_seq_cst);
+        if (m_sleepers.load(std::memory_order_seq_cst)) Futex::WakeAll(&m_phase);
+    }
+
+private:
+    const int m_spins;
+    alignas(Core::CacheLine) std::atomic<int> m_phase{0}; // Futex word
+    std::atomic<int> m_sleepers{0};
+};
+
+// Sense-reversing central barrier that spins before sleeping on a futex
+// - Much cheaper than Barrier for short phases, as long as threads <= CPUs
+// - The phase number acts as the sense, so no per-thread state is needed
+class SpinBarrier {
+public:
+    SpinBarrier(int count, int spins = BarrierPhase::DefaultSpins)
+        : m_count(count), m_phase(count, spins)
+    {
+        assert(count > 0);
+    }
+
+    SpinBarrier(const SpinBarrier&) = delete;
+    SpinBarrier& operator=(const SpinBarrier&) = delete;
+
+    // Returns true for exactly one thread of each phase (the last to arrive)
+    bool Wait() {
+        int phase = m_phase.Current();
+        if (m_arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == m_count) {
+            // Nobody can arrive for the next phase before it starts
+            m_arrived.store(0, std::memory_order_relaxed);
+            m_phase.Advance();
+            return true;
+        }
+
+        m_phase.Await(phase);
+        return false;
+    }
+
+private:
+    const int m_count;
+    alignas(Core::CacheLine) std::atomic<int> m_arrived{0};
+    BarrierPhase m_phase;
+};
+
+// Combining tree barrier for high thread counts
+// - Threads arrive in groups of fanIn on their own tree node (cache line),
+//   the last of each group carries the arrival up, so no counter sees
+//   more than fanIn threads
+// - The last arrival at the root releases everyone through one phase word
+// - Each thread passes its own id in [0, count)
+class TreeBarrier {
+public:
+    static const int DefaultFanIn = 4;
+
+    TreeBarrier(int count, int fanIn = DefaultFanIn, int spins = BarrierPhase::DefaultSpins)
+        : m_fanIn(fanIn), m_nodes(nodeCount(count, fanIn)), m_phase(count, spins)
+    {
+        assert(count > 0 && fanIn >= 2);
+
+        // Level by level from the leaves, each node waits for its children
+        int first = 0;
+        int width = (count + fanIn - 1) / fanIn;
+        int children = count;
+        for (;;) {
+            for (int i = 0; i < width; ++i) {
+                Node& node = m_nodes[first + i];
+                node.expected = std::min(fanIn, children - i*fanIn);
+                node.parent = (width == 1) ? -1 : first + width + i/fanIn;
+            }
+            if (width == 1) break;
+
+            first += width;
+            children = width;
+            width = (width + fanIn - 1) / fanIn;
+        }
+    }
+
+    TreeBarrier(const TreeBarrier&) = delete;
+    TreeBarrier& operator=(const TreeBarrier&) = delete;
+
+    // Returns true for exactly one thread of each phase (the one releasing it)
+    bool Wait(int id) {
+        int phase = m_phase.Current();
+
+        int index = id / m_fanIn;
+        while (index >= 0) {
+            Node& node = m_nodes[index];
+            if (node.arrived.fetch_add(1, std::memory_order_acq_rel) + 1 != node.expected) {
+                m_phase.Await(phase);
+                return false;
+            }
+
+            // Last of the group, reset the node (nobody else can reach it this phase) and climb
+            node.arrived.store(0, std::memory_order_relaxed);
+            index = node.parent;
+        }
+
+        m_phase.Advance();
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<int> arrived{0};
+        int expected = 0;
+        int parent = -1;
+    };
+
+    const int m_fanIn;
+    PaddedArray<Node> m_nodes;
+    BarrierPhase m_phase;
+
+    static int nodeCount(int count, int fanIn) {
+        int nodes = 0;
+        int width = count;
+        do {
+            width = (width + fanIn - 1) / fanIn;
+            nodes += width;
+        } while (width > 1);
+        return nodes;
+    }
+};
@@ -0,0 +1,202 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Channel.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "Core.h"
+#include "Futex.h"
+
+// Bounded multi-producer/multi-consumer queue
+// - Lock-free ring of sequence-numbered cells (after Dmitry Vyukov's design),
+//   so producers and consumers only contend on their own index
+// - Push()/Pop() block by sleeping on a futex, but only while full/empty,
+//   and only make a syscall to wake when someone is actually sleeping
+// - Close() wakes everyone, then Push() fails and Pop() fails once drained
+template<typename T>
+class Channel {
+public:
+    // capacity must be a power of two
+    Channel(size_t capacity)
+        : m_mask(capacity - 1), m_cells(new Cell[capacity])
+    {
+        assert(capacity >= 2 && !(capacity & (capacity-1)));
+        for (size_t i = 0; i < capacity; ++i)
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    ~Channel() {
+        // Destroy anything left unread
+        size_t end = m_enqueue.load(std::memory_order_relaxed);
+        for (size_t pos = m_dequeue.load(std::memory_order_relaxed); pos != end; ++pos)
+            reinterpret_cast<T*>(&m_cells[pos & m_mask].storage)->~T();
+    }
+
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    inline size_t Capacity() const { return m_mask + 1; }
+
+    // Add item if there is room, returns false (leaving item untouched) if full or closed
+    bool TryPush(const T& item) { return tryPush(item); }
+    bool TryPush(T&& item) { return tryPush(std::move(item)); }
+
+    // Take the oldest item into item, returns false if empty
+    bool TryPop(T& item) {
+        size_t pos = m_dequeue.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+
+            if (dif == 0) {
+                if (m_dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (dif < 0) {
+                return false; // Empty
+            } else {
+                pos = m_dequeue.load(std::memory_order_relaxed);
+            }
+        }
+
+        T* stored = reinterpret_cast<T*>(&cell->storage);
+        item = std::move(*stored);
+        stored->~T();
+        cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+
+        wake(m_notFull, m_fullWaiters);
+        return true;
+    }
+
+    // Add item, sleeping while full, returns false if the channel is closed
+    bool Push(T item) {
+        while (!tryPush(std::move(item))) {
+            if (Closed()) return false;
+            park(m_notFull, m_fullWaiters, [this]() { return !full() || Closed(); });
+        }
+        return true;
+    }
+
+    // Take the oldest item, sleeping while empty,
+    // returns false once the channel is closed and drained
+    bool Pop(T& item) {
+        while (!TryPop(item)) {
+            if (drained()) return false;
+            park(m_notEmpty, m_emptyWaiters, [this]() { return !empty() || Closed(); });
+        }
+        return true;
+    }
+
+    // Refuse further pushes and wake all sleepers
+    void Close() {
+        m_closed.store(true, std::memory_order_seq_cst);
+        m_notFull.fetch_add(1, std::memory_order_seq_cst);
+        m_notEmpty.fetch_add(1, std::memory_order_seq_cst);
+        Futex::WakeAll(&m_notFull);
+        Futex::WakeAll(&m_notEmpty);
+    }
+
+    inline bool Closed() { return m_closed.load(std::memory_order_acquire); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    const size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+
+    // Producer and consumer indices on separate cache lines
+    alignas(Core::CacheLine) std::atomic<size_t> m_enqueue{0};
+    std::atomic<int> m_pushing{0}; // Producers between checking Closed() and publishing
+    alignas(Core::CacheLine) std::atomic<size_t> m_dequeue{0};
+
+    // Futex words bumped when an item or a free cell appears, with sleeper counts
+    alignas(Core::CacheLine) std::atomic<int> m_notEmpty{0};
+    std::atomic<int> m_emptyWaiters{0};
+    alignas(Core::CacheLine) std::atomic<int> m_notFull{0};
+    std::atomic<int> m_fullWaiters{0};
+
+    std::atomic<bool> m_closed{false};
+
+    template<typename U>
+    bool tryPush(U&& item) {
+        // Counted before checking, so a consumer that sees the channel closed
+        // also sees this push as in flight until it is published (or given up)
+        m_pushing.fetch_add(1, std::memory_order_seq_cst);
+        if (m_closed.load(std::memory_order_seq_cst)) {
+            m_pushing.fetch_sub(1, std::memory_order_release);
+            return false;
+        }
+
+        size_t pos = m_enqueue.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+            if (dif == 0) {
+                if (m_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (dif < 0) {
+                m_pushing.fetch_sub(1, std::memory_order_release);
+                return false; // Full
+            } else {
+                pos = m_enqueue.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (&cell->storage) T(std::forward<U>(item));
+        cell->seq.store(pos + 1, std::memory_order_release);
+        m_pushing.fetch_sub(1, std::memory_order_release);
+
+        wake(m_notEmpty, m_emptyWaiters);
+        return true;
+    }
+
+    bool empty() {
+        size_t pos = m_dequeue.load(std::memory_order_seq_cst);
+        return (intptr_t)m_cells[pos & m_mask].seq.load(std::memory_order_seq_cst) - (intptr_t)(pos + 1) < 0;
+    }
+
+    // Closed, with no push left to land
+    bool drained() {
+        return m_closed.load(std::memory_order_seq_cst) && !m_pushing.load(std::memory_order_seq_cst) && empty();
+    }
+
+    bool full() {
+        size_t pos = m_enqueue.load(std::memory_order_seq_cst);
+        return (intptr_t)m_cells[pos & m_mask].seq.load(std::memory_order_seq_cst) - (intptr_t)pos < 0;
+    }
+
+    // Sleep on word unless ready() already holds once we are counted as a sleeper
+    template<typename Ready>
+    void park(std::atomic<int>& word, std::atomic<int>& waiters, Ready ready) {
+        int seq = word.load(std::memory_order_acquire);
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ready()) Futex::Wait(&word, seq);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Wake one sleeper, without a syscall when nobody sleeps
+    void wake(std::atomic<int>& word, std::atomic<int>& waiters) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed)) {
+            word.fetch_add(1, std::memory_order_release);
+            Futex::Wake(&word);
+        }
+    }
+};
@@ -6,25 +6,122 @@
 ==============================================================================*/
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
 #include <pthread.h>
+#include <time.h>
 
+#include "Futex.h"
+#include "LockProfile.h"
 #include "Mutex.h"
 
 // Wraps pthread_cond_t for convenience
+// - Timed waits use MonotonicClock (CLOCK_MONOTONIC), so wall clock changes don't affect them
+// - name labels the condition in LockRegistry reports (lock profiling builds only),
+//   where each wait counts as a contended acquisition lasting as long as it slept
 class Condition {
 public:
-    Condition() {
-        int err = pthread_cond_init(&m_cond, nullptr);
+    Condition() : Condition(nullptr) {}
+
+    explicit Condition(const char* name) {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        int err = pthread_cond_init(&m_cond, &attr);
         assert(!err);
+        pthread_condattr_destroy(&attr);
+#ifdef LIBTHREADING_LOCK_PROFILING
+        m_profile.SetName(name);
+#else
+        (void)name;
+#endif
     }
 
     ~Condition() { pthread_cond_destroy(&m_cond); }
 
-    void Wait(Mutex &mutex) { pthread_cond_wait(&m_cond, &(mutex.m_mutex)); }
-    void Signal() { pthread_cond_signal(&m_cond); }
-    void Broadcast() { pthread_cond_broadcast(&m_cond); }
+    void Wait(Mutex &mutex) { wait(mutex, nullptr); }
+
+    // Returns false if deadline passed first (mutex is held again either way)
+    bool WaitUntil(Mutex &mutex, MonotonicClock::time_point deadline) {
+        timespec ts = Futex::ToTimespec(deadline);
+        return wait(mutex, &ts);
+    }
+
+    template<class Rep, class Period>
+    bool WaitFor(Mutex &mutex, std::chrono::duration<Rep, Period> timeout) {
+        return WaitUntil(mutex, MonotonicClock::now() + timeout);
+    }
+
+    // FutexMutex waiters sleep on a sequence counter instead of the pthread_cond_t
+    void Wait(FutexMutex &mutex) { wait(mutex, nullptr); }
+
+    bool WaitUntil(FutexMutex &mutex, MonotonicClock::time_point deadline) { return wait(mutex, &deadline); }
+
+    template<class Rep, class Period>
+    bool WaitFor(FutexMutex &mutex, std::chrono::duration<Rep, Period> timeout) {
+        return WaitUntil(mutex, MonotonicClock::now() + timeout);
+    }
+
+    void Signal() {
+        if (m_futexWaiters.load(std::memory_order_relaxed)) {
+            m_seq.fetch_add(1, std::memory_order_relaxed);
+            Futex::Wake(&m_seq);
+        }
+        pthread_cond_signal(&m_cond);
+    }
+
+    void Broadcast() {
+        if (m_futexWaiters.load(std::memory_order_relaxed)) {
+            m_seq.fetch_add(1, std::memory_order_relaxed);
+            Futex::WakeAll(&m_seq);
+        }
+        pthread_cond_broadcast(&m_cond);
+    }
 
 private:
     pthread_cond_t m_cond;
+    std::atomic<int> m_seq{0}; // Futex word for FutexMutex waiters
+    std::atomic<int> m_futexWaiters{0};
+#ifdef LIBTHREADING_LOCK_PROFILING
+    LockProfile m_profile{"Condition"};
+#endif
+
+    // Returns false on timeout (deadline is absolute CLOCK_MONOTONIC, null for none)
+    bool wait(Mutex &mutex, const timespec* deadline) {
+#ifdef LIBTHREADING_LOCK_PROFILING
+        // The mutex is not held while asleep
+        mutex.m_profile.Released();
+        uint64_t start = LockProfile::Now();
+#endif
+        int err = deadline ? pthread_cond_timedwait(&m_cond, &(mutex.m_mutex), deadline)
+                           : pthread_cond_wait(&m_cond, &(mutex.m_mutex));
+#ifdef LIBTHREADING_LOCK_PROFILING
+        m_profile.Waited(start);
+        mutex.m_profile.Resumed();
+#endif
+        return err != ETIMEDOUT;
+    }
+
+    bool wait(FutexMutex &mutex, const MonotonicClock::time_point* deadline) {
+        int seq = m_seq.load(std::memory_order_relaxed);
+        m_futexWaiters.fetch_add(1, std::memory_order_relaxed);
+#ifdef LIBTHREADING_LOCK_PROFILING
+        // As for Mutex, the wait is not a fresh acquisition
+        mutex.m_profile.Released();
+        uint64_t start = LockProfile::Now();
+#endif
+        mutex.unlock();
+
+        bool inTime = Futex::Wait(&m_seq, seq, deadline);
+
+        m_futexWaiters.fetch_sub(1, std::memory_order_relaxed);
+        mutex.lock();
+#ifdef LIBTHREADING_LOCK_PROFILING
+        m_profile.Waited(start);
+        mutex.m_profile.Resumed();
+#endif
+        return inTime;
+    }
 };
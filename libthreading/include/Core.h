@@ -6,19 +6,47 @@
 ==============================================================================*/
 #pragma once
 
+#include <sched.h>
 #include <unistd.h>
+#include <atomic>
 #include <cassert>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 #include "Thread.h"
 
+// Policies for choosing which available CPU the n-th thread of a group runs on
+enum class Placement {
+    Compact,       // Fill SMT siblings, then cores sharing a cache, then further packages
+    Scatter,       // Spread over packages and physical cores before using SMT siblings
+    PhysicalCores, // One thread per physical core (wrapping around if more threads than cores)
+    SameL3         // Only CPUs sharing the L3 cache of the anchor (physical cores first)
+};
+
+// Where an available CPU sits in the machine
+// - Ids are as reported by sysfs, cache ids are the lowest CPU id sharing that cache
+struct CpuInfo {
+    int cpu;       // OS CPU id
+    int core;      // Physical core (unique over the machine)
+    int package;   // Socket
+    int node;      // NUMA node
+    int l2, l3;    // Cache domains
+    int smt;       // Position among the SMT siblings of its core (0 for the first)
+};
+
 // Allows a thread to be created on particular a cpu
 class Core {
 public:
     // WARNING: you MUST store the return variable of MakeThread(..) in a variable,
     // or else the constructed argument will go out of scope and be deleted!
     // e.g. auto t = Core::MakeThread<void,int>(cpu, func, i);
+    // (The callable version keeps its arguments and result inside the Thread,
+    //  so its result never points into a deleted argument)
+    // e.g. auto t = Core::MakeThread<long>(cpu, [](int *arr, int n) { ... }, arr, n);
+    //      long sum = t->Get();
+    // (cpu may also be a ThreadAttr, its Cpu() then being an available CPU index too)
+    // e.g. auto t = Core::MakeThread<void>(ThreadAttr(cpu).StackSize(64*1024).Name("worker"), func);
 
     static void Init() {
         // Store the total number of parallel resources
@@ -32,29 +60,111 @@ public:
         sched_getaffinity(0, sizeof(cpu_set_t), &cpus);
         // Then for each of the parallel resources in total,
         // check if that resource is available based on the affinity
-        for (int i = 0; i < (int)m_numProc; ++i)
-            if(CPU_ISSET(i, &cpus)) m_avail.push_back(i);
+        m_avail.clear();
+        m_index.assign(m_numProc, -1);
+        for (int i = 0; i < (int)m_numProc; ++i) {
+            if (CPU_ISSET(i, &cpus)) {
+                m_index[i] = m_avail.size();
+                m_avail.push_back(i);
+            }
+        }
         assert(m_avail.size());
+
+        // Discover where each CPU sits (SMT siblings, caches, NUMA nodes)
+        readTopology();
     }
 
+    // Size assumed for a cache line when padding data between threads
+    static const int CacheLine = 64;
+
     static inline unsigned int Count() { return m_avail.size(); }
     static inline unsigned int NumProc() { return m_numProc; }
 
+    // Index (as used by MakeThread) of the available CPU the caller is running on
+    // - Only a hint, the thread may be migrated right after
+    static inline int Current() {
+        int cpu = sched_getcpu();
+        int index = (cpu >= 0 && cpu < (int)m_index.size()) ? m_index[cpu] : -1;
+        return (index >= 0) ? index : 0;
+    }
+
+    // Topology of available CPU index (see CpuInfo)
+    static inline const CpuInfo& Info(int index) { return m_info[index]; }
+
+    static inline int NumNodes() { return m_numNodes; }
+    static inline int NumPackages() { return m_numPackages; }
+    static inline int NumCores() { return m_numCores; }
+
+    // Available CPU indices sharing a physical core with index (including itself)
+    static std::vector<int> Siblings(int index);
+    // Available CPU indices sharing the L3 cache of index (including itself)
+    static std::vector<int> SharingL3(int index);
+    // Available CPU indices on NUMA node
+    static std::vector<int> OnNode(int node);
+
+    // Available CPU index for the n-th thread of a group placed by policy
+    // - anchor is the CPU index the SameL3 policy is relative to (-1 for Current())
+    static int Place(Placement policy, int n, int anchor = -1);
+
+    // Small sequential id of the calling thread (0 for the first thread asking)
+    static inline int ThreadId() {
+        static std::atomic<int> s_next{0};
+        static thread_local int s_id = s_next.fetch_add(1, std::memory_order_relaxed);
+        return s_id;
+    }
+
     // Create a Thread (see Thread.h) on a particular CPU
     template<typename Ret, typename Arg> // Take Arg directly
-    static std::shared_ptr<Thread<Ret,Arg>> MakeThread(int cpu, void*(*task)(void*), Arg& arg) {
-        assert(cpu >= -1 && cpu < (int)Count());
-        return std::make_shared<Thread<Ret,Arg>>((cpu >= 0) ? m_avail[cpu] : cpu, task, arg);
+    static std::shared_ptr<Thread<Ret,Arg>> MakeThread(const ThreadAttr& attr, void*(*task)(void*), Arg& arg) {
+        return std::make_shared<Thread<Ret,Arg>>(place(attr), task, arg);
     }
 
     // Create a Thread (see Thread.h) on a particular CPU
     template<typename Ret, typename Arg, typename ... Args> // Construct Arg indirectly with Args
-    static std::shared_ptr<Thread<Ret,Arg>> MakeThread(int cpu, void*(*task)(void*), Args&& ... args) {
-        assert(cpu >= -1 && cpu < (int)Count());
-        return std::make_shared<Thread<Ret,Arg>>((cpu >= 0) ? m_avail[cpu] : cpu, task, std::forward<Args>(args) ...);
+    static std::shared_ptr<Thread<Ret,Arg>> MakeThread(const ThreadAttr& attr, void*(*task)(void*), Args&& ... args) {
+        return std::make_shared<Thread<Ret,Arg>>(place(attr), task, std::forward<Args>(args) ...);
+    }
+
+    // Create a Thread (see Thread.h) running any callable on a particular CPU
+    template<typename Ret, typename Task, typename ... Args>
+    static auto MakeThread(const ThreadAttr& attr, Task&& task, Args&& ... args)
+        -> typename std::enable_if<!std::is_convertible<Task, void*(*)(void*)>::value,
+            decltype((void)std::declval<CallResult<Task, Args...>>(), std::shared_ptr<Thread<Ret,void>>())>::type
+    {
+        return std::make_shared<Thread<Ret,void>>(place(attr), std::forward<Task>(task), std::forward<Args>(args) ...);
+    }
+
+    // Create a Thread (see Thread.h) for the n-th thread of a group placed by policy
+    // - SameL3 places relative to the calling thread's CPU
+    template<typename Ret, typename Arg, typename ... Args>
+    static std::shared_ptr<Thread<Ret,Arg>> MakeThread(Placement policy, int n, void*(*task)(void*), Args&& ... args) {
+        return MakeThread<Ret,Arg>(Place(policy, n), task, std::forward<Args>(args) ...);
+    }
+
+    // Create a Thread (see Thread.h) running any callable for the n-th thread of a group placed by policy
+    template<typename Ret, typename Task, typename ... Args>
+    static auto MakeThread(Placement policy, int n, Task&& task, Args&& ... args)
+        -> typename std::enable_if<!std::is_convertible<Task, void*(*)(void*)>::value,
+            decltype((void)std::declval<CallResult<Task, Args...>>(), std::shared_ptr<Thread<Ret,void>>())>::type
+    {
+        return MakeThread<Ret>(Place(policy, n), std::forward<Task>(task), std::forward<Args>(args) ...);
     }
 
 private:
     static unsigned int m_numProc;
     static std::vector<int> m_avail;
+    static std::vector<int> m_index; // CPU id to position in m_avail (-1 if unavailable)
+
+    static std::vector<CpuInfo> m_info; // Parallel to m_avail
+    static std::vector<int> m_compact, m_scatter, m_physical; // Placement orders
+    static int m_numNodes, m_numPackages, m_numCores;
+
+    static void readTopology();
+
+    // attr with its available CPU index turned into the OS CPU id
+    static ThreadAttr place(const ThreadAttr& attr) {
+        int cpu = attr.Cpu();
+        assert(cpu >= -1 && cpu < (int)Count());
+        return ThreadAttr(attr).Cpu((cpu >= 0) ? m_avail[cpu] : cpu);
+    }
 };
@@ -0,0 +1,414 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Coroutine.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+// C++20 coroutines run by pinned workers, compiled in only with LIBTHREADING_COROUTINES
+// (cmake -DCOROUTINES=ON, which also builds the library as C++20),
+// otherwise this header declares nothing
+#ifdef LIBTHREADING_COROUTINES
+
+#if !defined(__cpp_impl_coroutine)
+#error "Coroutine.h needs C++20 coroutines (-std=c++20)"
+#endif
+
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Condition.h"
+#include "Core.h"
+#include "Event.h"
+#include "Mutex.h"
+#include "Thread.h"
+#include "WorkStealingPool.h"
+
+template<typename T> class Task;
+
+// Promise parts shared by every Task
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation; // Whoever awaits the task
+    std::exception_ptr exception;
+
+    // Tasks are lazy, they start once awaited (or spawned)
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    // Resume the awaiter by symmetric transfer, so long await chains don't grow the stack
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> next = handle.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    void rethrow() { if (exception) std::rethrow_exception(exception); }
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+
+    template<typename U>
+    void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+
+    T& Result() {
+        rethrow();
+        return *value;
+    }
+};
+
+// (void specialization, there is nothing to store)
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+
+    void return_void() {}
+
+    void Result() { rethrow(); }
+};
+
+// Coroutine returning T, e.g.
+//      Task<int> answer() { co_return 42; }
+//      Task<void> ask() { int a = co_await answer(); ... }
+// - Starts when first awaited and resumes its awaiter when done
+// - Owns its frame, so a Task must outlive its execution (co_await and
+//   Executor::Spawn/SyncWait take care of that)
+template<typename T = void>
+class Task {
+public:
+    using promise_type = TaskPromise<T>;
+
+    Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (m_handle) m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { if (m_handle) m_handle.destroy(); }
+
+    inline bool Done() const { return !m_handle || m_handle.done(); }
+
+    // Run the task to completion, then continue with its result
+    // (moved out when awaiting a temporary)
+    auto operator co_await() & noexcept { return Awaiter<false>{m_handle}; }
+    auto operator co_await() && noexcept { return Awaiter<true>{m_handle}; }
+
+private:
+    friend promise_type;
+    friend class Executor;
+
+    std::coroutine_handle<promise_type> m_handle;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+    template<bool Move>
+    struct Awaiter {
+        std::coroutine_handle<promise_type> handle;
+
+        bool await_ready() noexcept { return !handle || handle.done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        decltype(auto) await_resume() {
+            if constexpr (std::is_void<T>::value || !Move) return handle.promise().Result();
+            else return std::move(handle.promise().Result());
+        }
+    };
+
+    // Result of the finished task (rethrows its exception)
+    T take() { return std::move(m_handle.promise().Result()); }
+};
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+template<>
+inline void Task<void>::take() { m_handle.promise().Result(); }
+
+// Runs coroutines on a fixed set of pinned workers, so many thousands of
+// waiting activities only cost their coroutine frames, not a thread each
+// - Coroutines resumed from a worker go to that worker's WorkDeque and idle
+//   workers steal, as in WorkStealingPool
+// - Coroutines resumed from other threads, or yielding, go to a shared FIFO
+//   queue, which workers also check regularly so it cannot starve
+// e.g.
+//      Executor executor(Core::Count());
+//      for (int i = 0; i < 100000; ++i) executor.Spawn(activity(i));
+//      executor.WaitIdle();
+class Executor {
+public:
+    // Start num_threads workers, pinning worker i where policy places it (see Core::Place)
+    // (requires Core::Init())
+    Executor(int num_threads, Placement policy = Placement::Compact) {
+        assert(num_threads > 0);
+
+        // All deques must exist before any worker starts stealing
+        for (int i = 0; i < num_threads; ++i)
+            m_workers.emplace_back(new Worker(this, i));
+
+        for (int i = 0; i < num_threads; ++i)
+            m_workers[i]->thread = Core::MakeThread<void,Worker*>(
+                ThreadAttr(Core::Place(policy, i)).Name("executor"), worker_task, m_workers[i].get());
+    }
+
+    // Runs every queued coroutine, then joins the workers
+    // - Coroutines still suspended (e.g. on an AsyncMutex) are never resumed, see WaitIdle()
+    ~Executor() {
+        {
+            ScopedMutex guard(m_lock);
+            m_stopping.store(true);
+            m_wake.Broadcast();
+        }
+        for (auto& worker : m_workers)
+            worker->thread->Join();
+    }
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    inline int Size() { return (int)m_workers.size(); }
+
+    // Resume handle on a worker
+    void Schedule(std::coroutine_handle<> handle) { push(handle.address(), false); }
+
+    // Start task as an independent activity, the executor owns it until it finishes
+    // - An exception escaping task terminates the program
+    void Spawn(Task<void> task) {
+        m_live.fetch_add(1, std::memory_order_relaxed);
+        Schedule(detach(this, std::move(task)).handle);
+    }
+
+    // Number of spawned tasks not yet finished
+    inline long Live() { return m_live.load(std::memory_order_acquire); }
+
+    // Sleep until every spawned task has finished (not from a worker)
+    void WaitIdle() {
+        assert(!IsWorker());
+        ScopedMutex guard(m_lock);
+        while (m_live.load(std::memory_order_acquire))
+            m_idle.Wait(m_lock);
+    }
+
+    // Run task on the workers and sleep until its result is ready (not from a worker)
+    template<typename T>
+    T SyncWait(Task<T> task) {
+        assert(!IsWorker());
+        // Shared, as the finishing worker may still touch it after we wake
+        auto done = std::make_shared<ManualResetEvent>();
+        Schedule(complete(task, done).handle);
+        done->Wait();
+        return task.take();
+    }
+
+    // co_await executor.Yield(): let the other queued coroutines run first
+    // (also moves a coroutine running elsewhere onto the workers)
+    auto Yield() {
+        struct Awaiter {
+            Executor* executor;
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { executor->push(handle.address(), true); }
+            void await_resume() noexcept {}
+        };
+        return Awaiter{this};
+    }
+
+    // Is the calling thread one of this executor's workers?
+    inline bool IsWorker() { return local() != nullptr; }
+
+    // Executor of the worker running on the calling thread (if any)
+    static inline Executor* Current() { return m_local ? m_local->executor : nullptr; }
+
+private:
+    // Root of a spawned (or synchronously waited) task, frees itself once finished
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    static Detached detach(Executor* executor, Task<void> task) {
+        co_await std::move(task);
+        executor->finished();
+    }
+
+    template<typename T>
+    static Detached complete(Task<T>& task, std::shared_ptr<ManualResetEvent> done) {
+        try {
+            co_await task;
+        } catch (...) {} // Kept in the task, rethrown by take()
+        done->Set();
+    }
+
+    struct Worker {
+        Executor* executor;
+        int index;
+        uint32_t seed; // For picking random victims
+        uint32_t runs = 0; // For checking the shared queue now and then
+        WorkDeque<void> deque;
+        std::shared_ptr<Thread<void,Worker*>> thread;
+
+        Worker(Executor* executor, int index)
+            : executor(executor), index(index), seed(2654435761u * (index + 1)) {}
+    };
+
+    // Local runs between two looks at the shared queue
+    static const uint32_t FairnessInterval = 61;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    // Coroutines resumed from outside the workers, or yielding (the only locked path)
+    Mutex m_lock{"Executor::m_lock"};
+    Condition m_wake{"Executor::m_wake"};
+    Condition m_idle{"Executor::m_idle"};
+    std::deque<void*> m_injected;
+
+    std::atomic<long> m_queued{0}; // Coroutines pushed but not yet taken
+    std::atomic<long> m_live{0};   // Spawned tasks not yet finished
+    std::atomic<int> m_sleepers{0};
+    std::atomic<bool> m_stopping{false};
+
+    // The worker running on the calling thread (if any)
+    static thread_local Worker* m_local;
+
+    Worker* local() { return (m_local && m_local->executor == this) ? m_local : nullptr; }
+
+    void push(void* handle, bool shared) {
+        // Count the coroutine before it is visible, so sleepers can never miss it
+        m_queued.fetch_add(1, std::memory_order_seq_cst);
+
+        Worker* self = shared ? nullptr : local();
+        if (self) {
+            self->deque.Push(handle);
+        } else {
+            ScopedMutex guard(m_lock);
+            m_injected.push_back(handle);
+        }
+
+        if (m_sleepers.load(std::memory_order_seq_cst)) {
+            ScopedMutex guard(m_lock);
+            m_wake.Signal();
+        }
+    }
+
+    void* takeInjected() {
+        if (!m_queued.load(std::memory_order_relaxed)) return nullptr;
+        ScopedMutex guard(m_lock);
+        if (m_injected.empty()) return nullptr;
+        void* handle = m_injected.front();
+        m_injected.pop_front();
+        return handle;
+    }
+
+    void* find(Worker* self) {
+        void* handle = nullptr;
+        if (++self->runs % FairnessInterval == 0) handle = takeInjected();
+        if (!handle) handle = self->deque.Pop();
+        if (!handle) handle = steal(self);
+        if (!handle) handle = takeInjected();
+
+        if (handle) m_queued.fetch_sub(1, std::memory_order_relaxed);
+        return handle;
+    }
+
+    // Try each other worker once, starting from a random victim
+    void* steal(Worker* self) {
+        int n = Size();
+        if (n < 2) return nullptr;
+
+        self->seed ^= self->seed << 13;
+        self->seed ^= self->seed >> 17;
+        self->seed ^= self->seed << 5;
+
+        int start = self->seed % n;
+        for (int i = 0; i < n; ++i) {
+            int victim = (start + i) % n;
+            if (victim == self->index) continue;
+            void* handle = m_workers[victim]->deque.Steal();
+            if (handle) return handle;
+        }
+        return nullptr;
+    }
+
+    // A spawned task finished
+    void finished() {
+        if (m_live.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            ScopedMutex guard(m_lock);
+            m_idle.Broadcast();
+        }
+    }
+
+    // Blocks until there might be work, returns false once stopping with nothing queued
+    bool idle() {
+        for (int i = 0; i < 64; ++i) {
+            if (m_queued.load(std::memory_order_relaxed)) return true;
+            sched_yield();
+        }
+
+        ScopedMutex guard(m_lock);
+        m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        while (!m_queued.load(std::memory_order_seq_cst) && !m_stopping.load())
+            m_wake.Wait(m_lock);
+        m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+
+        return m_queued.load() || !m_stopping.load();
+    }
+
+    // Define the worker function:
+    // --  void* worker_task(Worker** arg)
+    static THREAD_FUNC(worker_task, void,Worker*) {
+        Worker* self = *arg;
+        m_local = self;
+
+        for (;;) {
+            void* handle = self->executor->find(self);
+            if (handle) std::coroutine_handle<>::from_address(handle).resume();
+            else if (!self->executor->idle()) break;
+        }
+
+        m_local = nullptr;
+        THREAD_RETURN(nullptr);
+    }
+};
+
+#endif
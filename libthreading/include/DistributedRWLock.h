@@ -0,0 +1,116 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    DistributedRWLock.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <sched.h>
+#include <time.h>
+
+#include "Core.h"
+#include "PerCore.h"
+#include "RWLock.h"
+
+// Reader-scalable RWLock with a distributed reader indicator (after BRAVO)
+// - While biased towards readers, a reader only bumps the counter of its own CPU
+//   (on its own cache line), so read-mostly data scales with cores
+// - A writer takes the underlying RWLock, revokes the bias and waits for
+//   the per-core counters to drain; readers then use the RWLock until writers
+//   have been quiet for a while (InhibitFactor times the last revocation)
+// - Requires Core::Init()
+class DistributedRWLock {
+public:
+    static const int InhibitFactor = 9;
+
+    DistributedRWLock()
+        : m_readers(Core::Count(), 0L) {}
+
+    DistributedRWLock(const DistributedRWLock&) = delete;
+    DistributedRWLock& operator=(const DistributedRWLock&) = delete;
+
+    // Returns a token to pass to ReadUnlock()
+    int ReadLock() {
+        if (m_readBias.load(std::memory_order_acquire)) {
+            int slot = Core::Current() % m_readers.Size();
+            m_readers[slot].fetch_add(1, std::memory_order_seq_cst);
+            if (m_readBias.load(std::memory_order_seq_cst)) return slot; // Fast path
+            m_readers[slot].fetch_sub(1, std::memory_order_release);
+        }
+
+        m_lock.ReadLock();
+
+        // No writer can hold the lock now, so it is safe to restore the bias
+        if (!m_readBias.load(std::memory_order_relaxed) && now() >= m_inhibitUntil.load(std::memory_order_relaxed))
+            m_readBias.store(true, std::memory_order_release);
+        return SLOW_PATH;
+    }
+
+    void ReadUnlock(int token) {
+        if (token != SLOW_PATH) m_readers[token].fetch_sub(1, std::memory_order_release);
+        else m_lock.Unlock();
+    }
+
+    void WriteLock() {
+        m_lock.WriteLock();
+
+        if (m_readBias.load(std::memory_order_relaxed)) {
+            // Revoke the bias, then wait out the fast path readers
+            int64_t start = now();
+            m_readBias.store(false, std::memory_order_seq_cst);
+            for (int i = 0; i < m_readers.Size(); ++i)
+                while (m_readers[i].load(std::memory_order_acquire))
+                    sched_yield();
+
+            int64_t end = now();
+            m_inhibitUntil.store(end + (end - start)*InhibitFactor, std::memory_order_relaxed);
+        }
+    }
+
+    void WriteUnlock() { m_lock.Unlock(); }
+
+    inline bool ReadBiased() { return m_readBias.load(std::memory_order_relaxed); }
+
+private:
+    enum { SLOW_PATH = -1 };
+
+    RWLock m_lock; // Writers, and readers while not biased
+    PaddedArray<std::atomic<long>> m_readers; // Fast path readers per core
+    std::atomic<bool> m_readBias{true};
+    std::atomic<int64_t> m_inhibitUntil{0}; // Monotonic ns before which the bias stays off
+
+    static int64_t now() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+    }
+};
+
+// Sets distributed rwlock for read and automatically cleans up after itself
+class ScopedDistributedReadLock {
+public:
+    ScopedDistributedReadLock(DistributedRWLock& lock)
+        : m_lock(&lock), m_token(lock.ReadLock()) {}
+
+    ~ScopedDistributedReadLock() { m_lock->ReadUnlock(m_token); }
+
+private:
+    DistributedRWLock* m_lock;
+    int m_token;
+};
+
+// Sets distributed rwlock for write and automatically cleans up after itself
+class ScopedDistributedWriteLock {
+public:
+    ScopedDistributedWriteLock(DistributedRWLock& lock)
+        : m_lock(&lock)
+    { m_lock->WriteLock(); }
+
+    ~ScopedDistributedWriteLock() { m_lock->WriteUnlock(); }
+
+private:
+    DistributedRWLock* m_lock;
+};
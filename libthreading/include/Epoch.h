@@ -0,0 +1,144 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Epoch.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Mutex.h"
+
+// Epoch-based memory reclamation (RCU-style), for lock-free readers
+// - Readers traverse shared nodes inside a ReadGuard, which only announces the
+//   current epoch in the thread's own record (no shared writes)
+// - Writers unlink a node, then Retire() it; it is freed once every reader
+//   that could still see it has left its guard (two epoch advances later)
+// - Reclamation is amortized: every ReclaimThreshold retirements the retiring
+//   thread tries to advance the epoch and frees what has become safe
+// - Threads register on first use and unregister at thread exit
+class Epoch {
+public:
+    typedef void (*Deleter)(void*);
+
+    static const size_t ReclaimThreshold = 64;
+
+    // Claim a record for the calling thread (done once, nested calls are ignored)
+    static void Register();
+
+    // Release the calling thread's record, handing its pending retirements over
+    // to the other threads (must not be inside a ReadGuard)
+    static void Unregister();
+
+    // Enter/leave a read-side critical section (may nest, see ReadGuard)
+    static inline void Enter() {
+        if (!m_record) Register();
+        Record* record = m_record;
+        if (record->nesting++ == 0) {
+            record->epoch.store((m_global.load(std::memory_order_relaxed) << 1) | ACTIVE, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    static inline void Exit() {
+        Record* record = m_record;
+        assert(record && record->nesting > 0);
+        if (--record->nesting == 0) record->epoch.store(0, std::memory_order_release);
+    }
+
+    // Free ptr with deleter once no reader can still reference it
+    // - ptr must already be unreachable for new readers
+    static void Retire(void* ptr, Deleter deleter);
+
+    template<typename T>
+    static void Retire(T* ptr) { Retire((void*)ptr, &deleteAs<T>); }
+
+    // Block until everything retired so far has been freed
+    // (must not be inside a ReadGuard)
+    static void Synchronize();
+
+    static inline uint64_t Current() { return m_global.load(std::memory_order_acquire); }
+
+private:
+    enum { ACTIVE = 1 };
+
+    struct Retired {
+        void* ptr;
+        Deleter deleter;
+        uint64_t epoch;
+    };
+
+    // Per thread state, each on its own cache line(s)
+    // - Never freed, released records are reused by new threads
+    struct Record {
+        std::atomic<uint64_t> epoch{0}; // (epoch << 1) | ACTIVE while in a guard, else 0
+        std::atomic<bool> inUse{true};
+        Record* next = nullptr;
+        int nesting = 0;
+        size_t sinceReclaim = 0;
+        std::vector<Retired> limbo; // Retired by this thread, not yet freed
+    };
+
+    static std::atomic<uint64_t> m_global;
+    static std::atomic<Record*> m_records;
+    static thread_local Record* m_record;
+
+    // Retirements left behind by threads that exited, reclaimed by whoever comes next
+    static Mutex m_orphanLock;
+    static std::vector<Retired> m_orphans;
+
+    template<typename T>
+    static void deleteAs(void* ptr) { delete (T*)ptr; }
+
+    static bool tryAdvance();
+    static void reclaim(std::vector<Retired>& limbo);
+    static void reclaimOrphans();
+};
+
+// Marks a read-side critical section and automatically leaves it
+// - Pointers loaded inside the guard stay valid until it is destroyed
+class ReadGuard {
+public:
+    ReadGuard() { Epoch::Enter(); }
+    ~ReadGuard() { Epoch::Exit(); }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+};
+
+// Pointer to an immutable T, replaced as a whole by writers (read-copy-update)
+// e.g.
+//      Snapshot<Config> config(new Config());
+//      { ReadGuard guard; use(config.Get()->limit); }   // Readers never block
+//      Config* next = new Config(*config.Get()); next->limit = 10;
+//      config.Publish(next);                            // Old copy is retired
+// - Concurrent writers must serialize among themselves (e.g. copy under a Mutex)
+template<typename T>
+class Snapshot {
+public:
+    Snapshot(T* initial = nullptr)
+        : m_ptr(initial) {}
+
+    // Readers must be gone by then
+    ~Snapshot() { delete m_ptr.load(std::memory_order_relaxed); }
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    // Current value, only valid inside a ReadGuard (or for the writer)
+    inline const T* Get() const { return m_ptr.load(std::memory_order_acquire); }
+
+    // Make next visible to new readers, and retire the previous value
+    void Publish(T* next) {
+        T* old = m_ptr.exchange(next, std::memory_order_acq_rel);
+        if (old) Epoch::Retire(old);
+    }
+
+private:
+    std::atomic<T*> m_ptr;
+};
@@ -0,0 +1,105 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Event.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <atomic>
+
+#include "Futex.h"
+
+// Event that stays set, releasing every waiter, until Reset()
+// - Set() makes no syscall unless someone is asleep in Wait()
+// - Timed waits use MonotonicClock (CLOCK_MONOTONIC)
+class ManualResetEvent {
+public:
+    ManualResetEvent(bool set = false)
+        : m_set(set) {}
+
+    ManualResetEvent(const ManualResetEvent&) = delete;
+    ManualResetEvent& operator=(const ManualResetEvent&) = delete;
+
+    void Set() {
+        if (m_set.exchange(1, std::memory_order_seq_cst) == 0 && m_waiters.load(std::memory_order_seq_cst))
+            Futex::WakeAll(&m_set);
+    }
+
+    inline void Reset() { m_set.store(0, std::memory_order_relaxed); }
+    inline bool IsSet() { return m_set.load(std::memory_order_acquire); }
+
+    void Wait() { wait(nullptr); }
+
+    // Returns false if the event was not set in time
+    bool WaitUntil(MonotonicClock::time_point deadline) { return wait(&deadline); }
+
+    template<class Rep, class Period>
+    bool WaitFor(std::chrono::duration<Rep, Period> timeout) { return WaitUntil(MonotonicClock::now() + timeout); }
+
+private:
+    std::atomic<int> m_set; // Futex word
+    std::atomic<int> m_waiters{0};
+
+    bool wait(const MonotonicClock::time_point* deadline) {
+        while (!IsSet()) {
+            m_waiters.fetch_add(1, std::memory_order_seq_cst);
+            bool inTime = true;
+            if (!m_set.load(std::memory_order_seq_cst))
+                inTime = Futex::Wait(&m_set, 0, deadline);
+            m_waiters.fetch_sub(1, std::memory_order_relaxed);
+
+            if (!inTime) return IsSet();
+        }
+        return true;
+    }
+};
+
+// Event that releases a single waiter per Set(), then resets itself
+// - Setting an already set event has no further effect
+// - Set() makes no syscall unless someone is asleep in Wait()
+// - Timed waits use MonotonicClock (CLOCK_MONOTONIC)
+class AutoResetEvent {
+public:
+    AutoResetEvent(bool set = false)
+        : m_set(set) {}
+
+    AutoResetEvent(const AutoResetEvent&) = delete;
+    AutoResetEvent& operator=(const AutoResetEvent&) = delete;
+
+    void Set() {
+        m_set.store(1, std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_seq_cst)) Futex::Wake(&m_set);
+    }
+
+    // Consume the event if it is set
+    bool TryWait() {
+        int set = 1;
+        return m_set.compare_exchange_strong(set, 0, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void Wait() { wait(nullptr); }
+
+    // Returns false if the event was not set in time
+    bool WaitUntil(MonotonicClock::time_point deadline) { return wait(&deadline); }
+
+    template<class Rep, class Period>
+    bool WaitFor(std::chrono::duration<Rep, Period> timeout) { return WaitUntil(MonotonicClock::now() + timeout); }
+
+private:
+    std::atomic<int> m_set; // Futex word
+    std::atomic<int> m_waiters{0};
+
+    bool wait(const MonotonicClock::time_point* deadline) {
+        while (!TryWait()) {
+            m_waiters.fetch_add(1, std::memory_order_seq_cst);
+            bool inTime = true;
+            if (!m_set.load(std::memory_order_seq_cst))
+                inTime = Futex::Wait(&m_set, 0, deadline);
+            m_waiters.fetch_sub(1, std::memory_order_relaxed);
+
+            if (!inTime) return TryWait();
+        }
+        return true;
+    }
+};
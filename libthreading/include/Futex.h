@@ -0,0 +1,72 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Futex.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex words must be plain 32-bit ints");
+
+// Hint to the CPU that we are busy-waiting (frees resources for a hyperthread sibling)
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Clock of every timed wait, steady_clock reads CLOCK_MONOTONIC on Linux
+typedef std::chrono::steady_clock MonotonicClock;
+
+// Wraps the futex syscall for convenience
+// - Operates on process private std::atomic<int> words
+class Futex {
+public:
+    // Sleep while *word == expected (returns at once if it already differs)
+    // - May return spuriously, so callers must re-check their condition
+    static void Wait(std::atomic<int>* word, int expected) {
+        syscall(SYS_futex, (int*)word, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    // Wait() with a deadline, returns false once it has passed
+    static bool WaitUntil(std::atomic<int>* word, int expected, MonotonicClock::time_point deadline) {
+        timespec ts = ToTimespec(deadline);
+        // The bitset variant takes an absolute CLOCK_MONOTONIC time, so retries keep the same deadline
+        long err = syscall(SYS_futex, (int*)word, FUTEX_WAIT_BITSET_PRIVATE, expected, &ts, nullptr, FUTEX_BITSET_MATCH_ANY);
+        return !(err && errno == ETIMEDOUT);
+    }
+
+    // WaitUntil(*deadline), or Wait() if deadline is null (then always true)
+    static bool Wait(std::atomic<int>* word, int expected, const MonotonicClock::time_point* deadline) {
+        if (deadline) return WaitUntil(word, expected, *deadline);
+        Wait(word, expected);
+        return true;
+    }
+
+    // Wake up to count threads sleeping on word
+    static void Wake(std::atomic<int>* word, int count = 1) {
+        syscall(SYS_futex, (int*)word, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+
+    static void WakeAll(std::atomic<int>* word) { Wake(word, INT_MAX); }
+
+    // Absolute CLOCK_MONOTONIC time of a MonotonicClock time point
+    static timespec ToTimespec(MonotonicClock::time_point time) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        if (ns < 0) ns = 0;
+        timespec ts;
+        ts.tv_sec = ns / 1000000000;
+        ts.tv_nsec = ns % 1000000000;
+        return ts;
+    }
+};
@@ -0,0 +1,67 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Latch.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <cassert>
+
+#include "Futex.h"
+
+// Single use countdown on a futex word, waiters are released once it reaches zero
+// - CountDown() makes no syscall unless it releases someone asleep in Wait()
+// - Timed waits use MonotonicClock (CLOCK_MONOTONIC)
+class Latch {
+public:
+    Latch(int count)
+        : m_count(count)
+    {
+        assert(count >= 0);
+    }
+
+    Latch(const Latch&) = delete;
+    Latch& operator=(const Latch&) = delete;
+
+    void CountDown(int n = 1) {
+        int left = m_count.fetch_sub(n, std::memory_order_seq_cst) - n;
+        assert(left >= 0);
+        if (left == 0 && m_waiters.load(std::memory_order_seq_cst)) Futex::WakeAll(&m_count);
+    }
+
+    // Has the count reached zero?
+    inline bool TryWait() { return m_count.load(std::memory_order_acquire) == 0; }
+
+    void Wait() { wait(nullptr); }
+
+    // Returns false if the count did not reach zero in time
+    bool WaitUntil(MonotonicClock::time_point deadline) { return wait(&deadline); }
+
+    template<class Rep, class Period>
+    bool WaitFor(std::chrono::duration<Rep, Period> timeout) { return WaitUntil(MonotonicClock::now() + timeout); }
+
+    void ArriveAndWait(int n = 1) {
+        CountDown(n);
+        Wait();
+    }
+
+private:
+    std::atomic<int> m_count; // Futex word
+    std::atomic<int> m_waiters{0};
+
+    bool wait(const MonotonicClock::time_point* deadline) {
+        int count;
+        while ((count = m_count.load(std::memory_order_acquire)) != 0) {
+            m_waiters.fetch_add(1, std::memory_order_seq_cst);
+            bool inTime = true;
+            if (m_count.load(std::memory_order_seq_cst) == count)
+                inTime = Futex::Wait(&m_count, count, deadline);
+            m_waiters.fetch_sub(1, std::memory_order_relaxed);
+
+            if (!inTime) return TryWait();
+        }
+        return true;
+    }
+};
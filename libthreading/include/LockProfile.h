@@ -0,0 +1,135 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    LockProfile.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+// Lock contention profiling, compiled in only with LIBTHREADING_LOCK_PROFILING
+// (cmake -DLOCK_PROFILING=ON), otherwise this header declares nothing and the
+// locks are exactly as without it
+#ifdef LIBTHREADING_LOCK_PROFILING
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <time.h>
+#include <vector>
+
+// Statistics of one lock (embedded in Mutex, FutexMutex, RWLock and Condition)
+// - Wait times are only measured for contended acquisitions, so the uncontended
+//   path costs one clock read (for the hold time)
+// - Histograms have one bucket per power of two nanoseconds
+class LockProfile {
+public:
+    static const int Buckets = 32;
+
+    // Registers with LockRegistry
+    LockProfile(const char* kind);
+
+    // Unregisters, keeping the statistics if the lock was ever used
+    ~LockProfile();
+
+    LockProfile(const LockProfile&) = delete;
+    LockProfile& operator=(const LockProfile&) = delete;
+
+    void SetName(const char* name);
+
+    static inline uint64_t Now() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+    }
+
+    // The lock was taken exclusively, after waiting since start if contended
+    inline void Acquired(uint64_t start, bool contended) {
+        uint64_t now = Now();
+        count(start, now, contended);
+        m_holdStart = now;
+    }
+
+    // The lock was taken shared (hold times are only kept for exclusive holders)
+    inline void AcquiredShared(uint64_t start, bool contended) {
+        if (contended) count(start, Now(), true);
+        else m_acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The exclusive holder let go
+    inline void Released() {
+        uint64_t hold = Now() - m_holdStart;
+        m_holdNs.fetch_add(hold, std::memory_order_relaxed);
+        m_hold[bucket(hold)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The exclusive holder got the lock back without a new acquisition (after a Condition wait)
+    inline void Resumed() { m_holdStart = Now(); }
+
+    // A Condition waiter slept from start until now
+    inline void Waited(uint64_t start) { count(start, Now(), true); }
+
+private:
+    friend class LockRegistry;
+
+    const char* m_kind;
+    std::string m_name;
+
+    std::atomic<uint64_t> m_acquisitions{0};
+    std::atomic<uint64_t> m_contended{0};
+    std::atomic<uint64_t> m_waitNs{0};
+    std::atomic<uint64_t> m_holdNs{0};
+    std::atomic<uint64_t> m_wait[Buckets];
+    std::atomic<uint64_t> m_hold[Buckets];
+    uint64_t m_holdStart = 0; // Only written by the exclusive holder
+
+    inline void count(uint64_t start, uint64_t now, bool contended) {
+        m_acquisitions.fetch_add(1, std::memory_order_relaxed);
+        if (!contended) return;
+
+        uint64_t wait = now - start;
+        m_contended.fetch_add(1, std::memory_order_relaxed);
+        m_waitNs.fetch_add(wait, std::memory_order_relaxed);
+        m_wait[bucket(wait)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static inline int bucket(uint64_t ns) {
+        int b = ns ? 64 - __builtin_clzll(ns) : 0;
+        return (b < Buckets) ? b : Buckets - 1;
+    }
+};
+
+// Every profiled lock, live or destroyed, for reporting
+class LockRegistry {
+public:
+    // Copy of one lock's statistics
+    struct Entry {
+        std::string kind;
+        std::string name; // "kind@address" for unnamed live locks
+        uint64_t acquisitions = 0;
+        uint64_t contended = 0;
+        uint64_t waitNs = 0;
+        uint64_t holdNs = 0;
+        uint64_t wait[LockProfile::Buckets] = {};
+        uint64_t hold[LockProfile::Buckets] = {};
+    };
+
+    // All used locks, most total wait time first
+    // - Locks of the same kind and name are merged (e.g. one entry per named class member)
+    static std::vector<Entry> Collect();
+
+    // Human readable table of the top locks by total wait time
+    static void Report(std::ostream& out, int top = 20);
+
+    // Every used lock with full histograms, as a JSON array
+    static void Json(std::ostream& out);
+
+private:
+    friend class LockProfile;
+
+    static void add(LockProfile* profile);
+    static void remove(LockProfile* profile);
+    static Entry read(const LockProfile& profile);
+};
+
+#endif
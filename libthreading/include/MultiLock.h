@@ -0,0 +1,232 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    MultiLock.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <sched.h>
+#include <type_traits>
+#include <vector>
+
+#include "Mutex.h"
+
+// How LockAll acquires a set of locks without deadlocking
+enum class LockOrder {
+    // Block on each lock in address order, deadlock free as long as every thread
+    // taking more than one of them does the same (e.g. all use LockAll)
+    Address,
+
+    // Block on one lock and only try the rest, on failure release them all, yield,
+    // and start again from the lock that was busy; safe when other code takes the
+    // locks in any order (or holds some of them while waiting for others)
+    Backoff
+};
+
+// A Mutex or FutexMutex, so that both can be mixed in one set
+class LockRef {
+public:
+    LockRef() : m_lock(nullptr), m_futex(nullptr) {}
+    LockRef(Mutex& lock) : m_lock(&lock), m_futex(nullptr) {}
+    LockRef(FutexMutex& lock) : m_lock(nullptr), m_futex(&lock) {}
+
+    void Lock() { if (m_futex) m_futex->Lock(); else m_lock->Lock(); }
+    bool Try() { return m_futex ? m_futex->Try() : m_lock->Try(); }
+    void Unlock() { if (m_futex) m_futex->Unlock(); else m_lock->Unlock(); }
+
+    inline const void* Address() const { return m_futex ? (const void*)m_futex : (const void*)m_lock; }
+
+private:
+    Mutex* m_lock;
+    FutexMutex* m_futex;
+};
+
+// Operations on an array of locks, used by LockAll and ScopedMultiLock
+class MultiLock {
+public:
+    static void Lock(LockRef* locks, size_t count, LockOrder order) {
+        if (order == LockOrder::Address) lockOrdered(locks, count);
+        else lockBackoff(locks, count);
+    }
+
+    // All or nothing, never blocks
+    static bool Try(LockRef* locks, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!locks[i].Try()) {
+                while (i--) locks[i].Unlock();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void Unlock(LockRef* locks, size_t count) {
+        for (size_t i = count; i--; )
+            locks[i].Unlock();
+    }
+
+private:
+    // Sorts locks, so they are unlocked in reverse order too
+    // (insertion sort, as sets are usually a handful of locks)
+    static void lockOrdered(LockRef* locks, size_t count) {
+        for (size_t i = 1; i < count; ++i) {
+            LockRef lock = locks[i];
+            size_t j = i;
+            for (; j && std::less<const void*>()(lock.Address(), locks[j-1].Address()); --j)
+                locks[j] = locks[j-1];
+            locks[j] = lock;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            assert(!i || locks[i].Address() != locks[i-1].Address()); // The same lock twice never frees up
+            locks[i].Lock();
+        }
+    }
+
+    static void lockBackoff(LockRef* locks, size_t count) {
+        if (!count) return;
+        assert(distinct(locks, count)); // Trying a lock already taken fails forever
+
+        size_t first = 0;
+        for (;;) {
+            // Only ever wait on one lock, while holding none
+            locks[first].Lock();
+
+            size_t busy = count;
+            for (size_t i = 1; i < count; ++i) {
+                size_t next = (first + i) % count;
+                if (!locks[next].Try()) {
+                    busy = next;
+                    break;
+                }
+            }
+            if (busy == count) return;
+
+            for (size_t i = first; i != busy; i = (i + 1) % count)
+                locks[i].Unlock();
+
+            // Let the holder get on, then wait on the busy lock rather than spin on the free ones
+            sched_yield();
+            first = busy;
+        }
+    }
+
+    // (for debug checks, quadratic but sets are small)
+    static bool distinct(const LockRef* locks, size_t count) {
+        for (size_t i = 0; i < count; ++i)
+            for (size_t j = i + 1; j < count; ++j)
+                if (locks[i].Address() == locks[j].Address()) return false;
+        return true;
+    }
+};
+
+template<bool...> struct LockBoolPack;
+
+// Whether Locks are one or more Mutex or FutexMutex
+template<class... Locks>
+struct AreLocks : std::integral_constant<bool, sizeof...(Locks) != 0 &&
+    std::is_same<LockBoolPack<true, std::is_constructible<LockRef, Locks&>::value...>,
+        LockBoolPack<std::is_constructible<LockRef, Locks&>::value..., true>>::value> {};
+
+// Whether Iterator ranges over pointers to Mutex or FutexMutex
+template<class Iterator>
+using IsLockIterator = std::is_constructible<LockRef, decltype(**std::declval<Iterator>())>;
+
+// Lock every one of locks without deadlocking (none of them twice), e.g.
+//      LockAll(from.lock, to.lock);
+//      ...
+//      UnlockAll(from.lock, to.lock);
+template<class... Locks, class = typename std::enable_if<AreLocks<Locks...>::value>::type>
+void LockAll(Locks&... locks) {
+    LockRef refs[] = {LockRef(locks)...};
+    MultiLock::Lock(refs, sizeof...(locks), LockOrder::Address);
+}
+
+template<class... Locks, class = typename std::enable_if<AreLocks<Locks...>::value>::type>
+void LockAll(LockOrder order, Locks&... locks) {
+    LockRef refs[] = {LockRef(locks)...};
+    MultiLock::Lock(refs, sizeof...(locks), order);
+}
+
+// Returns true holding all of locks, or false holding none of them
+template<class... Locks, class = typename std::enable_if<AreLocks<Locks...>::value>::type>
+bool TryLockAll(Locks&... locks) {
+    LockRef refs[] = {LockRef(locks)...};
+    return MultiLock::Try(refs, sizeof...(locks));
+}
+
+template<class... Locks, class = typename std::enable_if<AreLocks<Locks...>::value>::type>
+void UnlockAll(Locks&... locks) {
+    LockRef refs[] = {LockRef(locks)...};
+    MultiLock::Unlock(refs, sizeof...(locks));
+}
+
+// (for a range of Mutex* or FutexMutex*)
+template<class Iterator, class = typename std::enable_if<IsLockIterator<Iterator>::value>::type>
+void LockAll(Iterator first, Iterator last, LockOrder order = LockOrder::Address) {
+    std::vector<LockRef> refs;
+    for (; first != last; ++first)
+        refs.emplace_back(**first);
+    MultiLock::Lock(refs.data(), refs.size(), order);
+}
+
+template<class Iterator, class = typename std::enable_if<IsLockIterator<Iterator>::value>::type>
+void UnlockAll(Iterator first, Iterator last) {
+    for (; first != last; ++first)
+        (*first)->Unlock();
+}
+
+// Locks a set of locks and automatically unlocks them after itself, e.g.
+//      ScopedMultiLock guard(from.lock, to.lock);
+//      ScopedMultiLock guard(LockOrder::Backoff, a, b, c);
+//      ScopedMultiLock guard(mutexes.begin(), mutexes.end()); // Mutex* or FutexMutex* range
+// - Sets of up to InlineLocks are kept without allocating
+class ScopedMultiLock {
+public:
+    static const size_t InlineLocks = 4;
+
+    template<class... Locks, class = typename std::enable_if<AreLocks<Locks...>::value>::type>
+    ScopedMultiLock(Locks&... locks)
+        : ScopedMultiLock(LockOrder::Address, locks...) {}
+
+    template<class... Locks, class = typename std::enable_if<AreLocks<Locks...>::value>::type>
+    ScopedMultiLock(LockOrder order, Locks&... locks) {
+        LockRef refs[] = {LockRef(locks)...};
+        acquire(refs, refs + sizeof...(locks), order);
+    }
+
+    template<class Iterator, class = typename std::enable_if<IsLockIterator<Iterator>::value>::type>
+    ScopedMultiLock(Iterator first, Iterator last, LockOrder order = LockOrder::Address) {
+        std::vector<LockRef> refs;
+        for (; first != last; ++first)
+            refs.emplace_back(**first);
+        acquire(refs.data(), refs.data() + refs.size(), order);
+    }
+
+    ~ScopedMultiLock() { MultiLock::Unlock(m_locks, m_count); }
+
+    ScopedMultiLock(const ScopedMultiLock&) = delete;
+    ScopedMultiLock& operator=(const ScopedMultiLock&) = delete;
+
+private:
+    LockRef m_inline[InlineLocks];
+    std::vector<LockRef> m_spill; // Only for sets larger than InlineLocks
+    LockRef* m_locks;
+    size_t m_count;
+
+    void acquire(LockRef* first, LockRef* last, LockOrder order) {
+        m_count = last - first;
+        if (m_count <= InlineLocks) {
+            std::copy(first, last, m_inline);
+            m_locks = m_inline;
+        } else {
+            m_spill.assign(first, last);
+            m_locks = m_spill.data();
+        }
+        MultiLock::Lock(m_locks, m_count, order);
+    }
+};
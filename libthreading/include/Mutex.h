@@ -6,28 +6,172 @@
 ==============================================================================*/
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <pthread.h>
 
+#include "Futex.h"
+#include "LockProfile.h"
+
 class Condition;
 
 // Wraps pthread_mutex_t for convenience
+// - name labels the lock in LockRegistry reports (lock profiling builds only)
 class Mutex {
 public:
-    Mutex() {
+    Mutex() : Mutex(nullptr) {}
+
+    explicit Mutex(const char* name) {
         int err = pthread_mutex_init(&m_mutex, nullptr);
         assert(!err);
+#ifdef LIBTHREADING_LOCK_PROFILING
+        m_profile.SetName(name);
+#else
+        (void)name;
+#endif
     }
 
     ~Mutex() { pthread_mutex_destroy(&m_mutex); }
 
+#ifndef LIBTHREADING_LOCK_PROFILING
     bool Try() { return pthread_mutex_trylock(&m_mutex) == 0; }
     void Lock() { pthread_mutex_lock(&m_mutex); }
     void Unlock() { pthread_mutex_unlock(&m_mutex); }
+#else
+    bool Try() {
+        if (pthread_mutex_trylock(&m_mutex)) return false;
+        m_profile.Acquired(0, false);
+        return true;
+    }
+
+    void Lock() {
+        if (pthread_mutex_trylock(&m_mutex) == 0) {
+            m_profile.Acquired(0, false);
+            return;
+        }
+        uint64_t start = LockProfile::Now();
+        pthread_mutex_lock(&m_mutex);
+        m_profile.Acquired(start, true);
+    }
+
+    void Unlock() {
+        m_profile.Released();
+        pthread_mutex_unlock(&m_mutex);
+    }
+#endif
 
 private:
     friend Condition;
     pthread_mutex_t m_mutex;
+#ifdef LIBTHREADING_LOCK_PROFILING
+    LockProfile m_profile{"Mutex"};
+#endif
+};
+
+// Mutex built directly on a futex, for very short critical sections
+// - Spins (with CpuRelax()) before sleeping in the kernel, adapting the
+//   spin length to how long the lock has recently taken to free up
+// - maxSpins bounds the spinning (0 sleeps straight away)
+// - name labels the lock in LockRegistry reports (lock profiling builds only)
+class FutexMutex {
+public:
+    static const int DefaultMaxSpins = 100;
+
+    FutexMutex() : FutexMutex(DefaultMaxSpins) {}
+
+    explicit FutexMutex(int maxSpins, const char* name = nullptr)
+        : m_maxSpins(maxSpins)
+    {
+#ifdef LIBTHREADING_LOCK_PROFILING
+        m_profile.SetName(name);
+#else
+        (void)name;
+#endif
+    }
+
+    FutexMutex(const FutexMutex&) = delete;
+    FutexMutex& operator=(const FutexMutex&) = delete;
+
+    bool Try() {
+#ifdef LIBTHREADING_LOCK_PROFILING
+        if (!tryLock()) return false;
+        m_profile.Acquired(0, false);
+        return true;
+#else
+        return tryLock();
+#endif
+    }
+
+    void Lock() {
+#ifdef LIBTHREADING_LOCK_PROFILING
+        if (tryLock()) {
+            m_profile.Acquired(0, false);
+            return;
+        }
+        uint64_t start = LockProfile::Now();
+        lockContended();
+        m_profile.Acquired(start, true);
+#else
+        if (tryLock()) return;
+        lockContended();
+#endif
+    }
+
+    void Unlock() {
+#ifdef LIBTHREADING_LOCK_PROFILING
+        m_profile.Released();
+#endif
+        unlock();
+    }
+
+    inline int MaxSpins() { return m_maxSpins; }
+    inline void SetMaxSpins(int maxSpins) { m_maxSpins = maxSpins; }
+
+private:
+    friend Condition;
+    enum { UNLOCKED, LOCKED, CONTENDED };
+
+    std::atomic<int> m_state{UNLOCKED}; // Futex word
+    std::atomic<int> m_avgSpins{0}; // Recent spins needed to acquire
+    int m_maxSpins;
+#ifdef LIBTHREADING_LOCK_PROFILING
+    LockProfile m_profile{"FutexMutex"};
+#endif
+
+    bool tryLock() {
+        int state = UNLOCKED;
+        return m_state.compare_exchange_strong(state, LOCKED, std::memory_order_acquire);
+    }
+
+    // (Lock() and Unlock() without profiling, so Condition can count a wait as one hold)
+    void lock() {
+        if (!tryLock()) lockContended();
+    }
+
+    void unlock() {
+        // Only enter the kernel if someone may be sleeping
+        if (m_state.exchange(UNLOCKED, std::memory_order_release) == CONTENDED)
+            Futex::Wake(&m_state);
+    }
+
+    void lockContended() {
+        // Spin while the holder is likely to release soon
+        int avg = m_avgSpins.load(std::memory_order_relaxed);
+        int limit = std::min(m_maxSpins, 2*avg + 10);
+        for (int i = 0; i < limit; ++i) {
+            CpuRelax();
+            if (m_state.load(std::memory_order_relaxed) == UNLOCKED && tryLock()) {
+                m_avgSpins.store(avg + (i - avg)/8, std::memory_order_relaxed);
+                return;
+            }
+        }
+        if (limit) m_avgSpins.store(avg + (limit - avg)/8, std::memory_order_relaxed);
+
+        // Sleep, marking the lock so the holder knows to wake someone
+        while (m_state.exchange(CONTENDED, std::memory_order_acquire) != UNLOCKED)
+            Futex::Wait(&m_state, CONTENDED);
+    }
 };
 
 // Sets mutex and automatically cleans up after itself
@@ -42,3 +186,16 @@ public:
 private:
     Mutex* m_lock;
 };
+
+// Sets futex mutex and automatically cleans up after itself
+class ScopedFutexMutex {
+public:
+    ScopedFutexMutex(FutexMutex& lock)
+        : m_lock(&lock)
+    { m_lock->Lock(); }
+
+    ~ScopedFutexMutex() { m_lock->Unlock(); }
+
+private:
+    FutexMutex* m_lock;
+};
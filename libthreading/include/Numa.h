@@ -0,0 +1,156 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Numa.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <linux/mempolicy.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+#include "Core.h"
+#include "Parallel.h"
+#include "ThreadPool.h"
+
+// Places memory on NUMA nodes through the mbind/set_mempolicy syscalls
+// - Nodes are as reported by Core (see CpuInfo::node), requires Core::Init()
+// - Policies are hints, calls return false if the kernel refuses them
+//   (e.g. no NUMA support) and memory is then placed as usual
+class Numa {
+public:
+    static inline size_t PageSize() { return sysconf(_SC_PAGESIZE); }
+
+    // Map bytes (rounded up to whole pages) of untouched anonymous memory
+    // - Pages are only placed once a policy is set or they are first written
+    static void* Allocate(size_t bytes) {
+        if (!bytes) return nullptr;
+        void* memory = mmap(nullptr, roundUp(bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) throw std::bad_alloc();
+        return memory;
+    }
+
+    static void Free(void* memory, size_t bytes) {
+        if (memory) munmap(memory, roundUp(bytes));
+    }
+
+    // Place the pages of [memory, memory+bytes) on node (memory must be page aligned)
+    static bool Bind(void* memory, size_t bytes, int node) {
+        assert(node >= 0 && node < (int)sizeof(unsigned long)*8);
+        unsigned long mask = 1UL << node;
+        return !syscall(SYS_mbind, memory, roundUp(bytes), MPOL_BIND, &mask, sizeof(mask)*8, MPOL_MF_MOVE);
+    }
+
+    // Spread the pages of [memory, memory+bytes) round robin over every node
+    static bool Interleave(void* memory, size_t bytes) {
+        unsigned long mask = allNodes();
+        return !syscall(SYS_mbind, memory, roundUp(bytes), MPOL_INTERLEAVE, &mask, sizeof(mask)*8, MPOL_MF_MOVE);
+    }
+
+    // Prefer node for the calling thread's future allocations (-1 restores the default, local, policy)
+    static bool PreferNode(int node) {
+        if (node < 0) return !syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+        unsigned long mask = 1UL << node;
+        return !syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, sizeof(mask)*8);
+    }
+
+    // NUMA node of an available CPU index (0 for unpinned, -1)
+    static inline int NodeOf(int cpu) { return (cpu >= 0) ? Core::Info(cpu).node : 0; }
+
+private:
+    static size_t roundUp(size_t bytes) {
+        size_t page = PageSize();
+        return ((bytes + page - 1) / page) * page;
+    }
+
+    static unsigned long allNodes() {
+        unsigned long mask = 0;
+        for (unsigned int i = 0; i < Core::Count(); ++i)
+            mask |= 1UL << Core::Info(i).node;
+        return mask ? mask : 1UL;
+    }
+};
+
+// Array of trivial T in page aligned memory, whose pages can be placed on the
+// NUMA node of the pool worker that processes them
+// e.g.
+//      ThreadPool pool(n, Placement::Scatter);
+//      NumaArray<int> arr(size);
+//      arr.Distribute(pool);   // Bind each static part to its worker's node
+//      arr.FirstTouch(pool, 0); // And write it from that worker
+//      ParallelReduce(pool, Range<size_t>(0, size), ...); // Static parts now read local memory
+template<typename T>
+class NumaArray {
+public:
+    static_assert(std::is_trivial<T>::value, "NumaArray only holds trivial types");
+
+    NumaArray(size_t size)
+        : m_size(size), m_data((T*) Numa::Allocate(size*sizeof(T))) {}
+
+    ~NumaArray() { Numa::Free(m_data, m_size*sizeof(T)); }
+
+    NumaArray(const NumaArray&) = delete;
+    NumaArray& operator=(const NumaArray&) = delete;
+
+    inline size_t Size() const { return m_size; }
+    inline T* Data() { return m_data; }
+    inline T& operator[](size_t i) { return m_data[i]; }
+
+    // Bind each part of a static split over pool (see Schedule::Static)
+    // to the NUMA node of the worker that runs that part
+    // - Returns false if any part could not be bound (parts of unpinned workers are skipped)
+    bool Distribute(ThreadPool& pool) {
+        Range<size_t> range(0, m_size);
+        int parts = Parts(pool, range);
+        if (parts <= 0) return true;
+
+        size_t page = Numa::PageSize();
+        uintptr_t base = (uintptr_t) m_data;
+        uintptr_t end = base + m_size*sizeof(T);
+        bool bound = true;
+
+        for (int part = 0; part < parts; ++part) {
+            // Same boundaries as ParallelChunks' static schedule,
+            // rounded so each page belongs to exactly one part
+            size_t delta = m_size / parts;
+            size_t rem = m_size % parts;
+            size_t start = part*delta + std::min<size_t>(part, rem);
+            size_t stop = start + delta + (size_t)(part < (int)rem);
+
+            uintptr_t first = (part == 0) ? base : alignUp(base + start*sizeof(T), page);
+            uintptr_t last = (part == parts-1) ? end : alignUp(base + stop*sizeof(T), page);
+            if (first >= last) continue;
+
+            // Unpinned workers may run anywhere, leave their part to first touch
+            int cpu = pool.WorkerCpu(part % pool.Size());
+            if (cpu < 0) continue;
+
+            bound &= Numa::Bind((void*) first, last - first, Numa::NodeOf(cpu));
+        }
+        return bound;
+    }
+
+    // Write value to every element, each static part from the worker that runs it,
+    // so pages land on that worker's node even without Distribute()
+    void FirstTouch(ThreadPool& pool, const T& value) {
+        T* data = m_data;
+        ParallelFor(pool, Range<size_t>(0, m_size), [data, &value](size_t i) { data[i] = value; });
+    }
+
+private:
+    size_t m_size;
+    T* m_data;
+
+    static uintptr_t alignUp(uintptr_t address, size_t page) {
+        return ((address + page - 1) / page) * page;
+    }
+};
@@ -0,0 +1,156 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Parallel.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "Latch.h"
+#include "PerCore.h"
+#include "ThreadPool.h"
+
+// How a Range is split between the workers
+enum class Schedule {
+    Static,  // One contiguous block per worker, always the same worker for the same block
+    Dynamic, // Workers repeatedly claim chunks of grain indices
+    Guided   // Like Dynamic, but chunks start large and shrink towards grain
+};
+
+// Half-open range of indices [begin, end) to run over in parallel
+// - grain is the smallest chunk handed to a worker (0 picks one automatically)
+template<typename Index>
+struct Range {
+    Index begin, end;
+    Index grain;
+    Schedule schedule;
+
+    Range(Index begin, Index end, Index grain = 0, Schedule schedule = Schedule::Static)
+        : begin(begin), end(end), grain(grain), schedule(schedule) {}
+
+    inline long Size() const { return (end > begin) ? (long)(end - begin) : 0; }
+};
+
+// Split range over the pool, calling chunk(part, begin, end) for each piece of work
+// - part identifies the task running the chunk, in [0, Parts(pool, range))
+// - Returns once every chunk has finished
+// - May be called from a body already running on pool (nested loops), the calling
+//   worker then runs queued tasks while any are left, before sleeping
+template<typename Index, typename Chunk>
+void ParallelChunks(ThreadPool& pool, const Range<Index>& range, Chunk chunk);
+
+// Number of parts (and so of partial results) ParallelChunks will use
+template<typename Index>
+int Parts(ThreadPool& pool, const Range<Index>& range) {
+    long size = range.Size();
+    long grain = std::max<long>(range.grain, 1);
+    return (int)std::min<long>(pool.Size(), (size + grain - 1) / grain);
+}
+
+// Call body(i) for every index in range, on the pool's workers
+template<typename Index, typename Body>
+void ParallelFor(ThreadPool& pool, const Range<Index>& range, Body body) {
+    ParallelChunks(pool, range, [&body](int, Index begin, Index end) {
+        for (Index i = begin; i < end; ++i)
+            body(i);
+    });
+}
+
+// Fold every index in range into a result, on the pool's workers
+// - op(partial, i) folds index i into a partial result (starting at identity)
+// - combine(a, b) merges two partial results, in part order
+// e.g. sum of arr: ParallelReduce(pool, Range<int>(0, n), 0L,
+//          [arr](long s, int i) { return s + arr[i]; }, std::plus<long>());
+template<typename Index, typename T, typename Op, typename Combine>
+T ParallelReduce(ThreadPool& pool, const Range<Index>& range, T identity, Op op, Combine combine) {
+    int parts = Parts(pool, range);
+    if (parts <= 0) return identity;
+
+    // One partial result per part, each on its own cache line so workers never share one
+    PaddedArray<T> partials(parts, identity);
+
+    ParallelChunks(pool, range, [&partials, &op](int part, Index begin, Index end) {
+        T partial = partials[part];
+        for (Index i = begin; i < end; ++i)
+            partial = op(partial, i);
+        partials[part] = partial;
+    });
+
+    return partials.Combine(identity, combine);
+}
+
+template<typename Index, typename Chunk>
+void ParallelChunks(ThreadPool& pool, const Range<Index>& range, Chunk chunk) {
+    long size = range.Size();
+    int parts = Parts(pool, range);
+    if (parts <= 0) return;
+
+    // Automatic grain gives each worker about 8 chunks to balance with
+    long grain = (range.grain > 0) ? (long)range.grain : std::max<long>(size / (8L*parts), 1);
+    Index begin = range.begin;
+
+    // Next unclaimed offset, for the dynamic schedules
+    std::atomic<long> next{0};
+
+    // Counted down by each part as it ends
+    Latch finished(parts);
+
+    std::vector<std::shared_ptr<PoolTask<void>>> tasks;
+    tasks.reserve(parts);
+
+    for (int part = 0; part < parts; ++part) {
+        Schedule schedule = range.schedule;
+        auto body = [=, &chunk, &next]() {
+            if (schedule == Schedule::Static) {
+                // Same boundaries as an even split with the remainder spread over the first parts
+                long delta = size / parts;
+                long rem = size % parts;
+                long start = part*delta + std::min<long>(part, rem);
+                long part_size = delta + (long)(part < rem);
+                chunk(part, (Index)(begin + start), (Index)(begin + start + part_size));
+                return;
+            }
+
+            for (;;) {
+                long start = next.load(std::memory_order_relaxed);
+                long step = grain;
+                if (schedule == Schedule::Guided)
+                    step = std::max(grain, (size - start) / (2*parts));
+
+                if (start >= size) return;
+                if (!next.compare_exchange_weak(start, start + step, std::memory_order_relaxed))
+                    continue;
+
+                long stop = std::min(size, start + step);
+                chunk(part, (Index)(begin + start), (Index)(begin + stop));
+            }
+        };
+
+        auto part_task = [body, &finished]() {
+            body();
+            finished.CountDown();
+        };
+
+        // Static parts always run on the same worker, so data first touched by
+        // a static loop stays local to the worker processing it later
+        if (schedule == Schedule::Static) tasks.push_back(pool.SubmitTo(part % pool.Size(), part_task));
+        else tasks.push_back(pool.Submit(part_task));
+    }
+
+    // A worker of pool (e.g. a nested loop) runs queued tasks rather than blocking,
+    // otherwise once every worker waited here none would be left to run the parts;
+    // once it finds none the rest are with other workers, so it can sleep
+    if (pool.IsWorker()) {
+        while (!finished.TryWait() && pool.RunOne()) {}
+    }
+    finished.Wait();
+
+    // (every part has also left CountDown(), so finished may go out of scope)
+    for (auto& task : tasks)
+        task->Wait();
+}
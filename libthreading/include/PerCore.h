@@ -0,0 +1,105 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    PerCore.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#include "Core.h"
+
+// Fixed size array whose elements each sit on their own cache line(s),
+// so threads writing neighbouring elements do not invalidate each other
+template<typename T>
+class PaddedArray {
+public:
+    // Construct size elements, each as T(args...)
+    template<typename ... Args>
+    PaddedArray(int size, Args&& ... args)
+        : m_size(size)
+    {
+        assert(size > 0);
+        void* memory = nullptr;
+        int err = posix_memalign(&memory, Core::CacheLine, sizeof(Slot)*size);
+        assert(!err && memory);
+        if (err) throw std::bad_alloc();
+
+        m_slots = (Slot*) memory;
+        for (int i = 0; i < size; ++i)
+            new (&m_slots[i]) Slot(args ...);
+    }
+
+    ~PaddedArray() {
+        for (int i = 0; i < m_size; ++i)
+            m_slots[i].~Slot();
+        free(m_slots);
+    }
+
+    PaddedArray(const PaddedArray&) = delete;
+    PaddedArray& operator=(const PaddedArray&) = delete;
+
+    inline int Size() const { return m_size; }
+
+    inline T& operator[](int i) { return m_slots[i].value; }
+    inline const T& operator[](int i) const { return m_slots[i].value; }
+
+    // Fold every element into a result, e.g.
+    //      long total = counters.Combine(0L, [](long sum, const std::atomic<long>& c) { return sum + c.load(); });
+    template<typename R, typename Op>
+    R Combine(R identity, Op op) const {
+        R result = identity;
+        for (int i = 0; i < m_size; ++i)
+            result = op(result, m_slots[i].value);
+        return result;
+    }
+
+private:
+    struct alignas(Core::CacheLine) Slot {
+        T value;
+
+        template<typename ... Args>
+        Slot(Args& ... args) : value(args ...) {}
+    };
+
+    Slot* m_slots;
+    int m_size;
+};
+
+// One element per available CPU (see Core), found through the CPU the caller runs on
+// - Requires Core::Init()
+// - A thread may be preempted or migrated while using its element, so elements
+//   written by several threads should be atomic (uncontended atomics stay cheap),
+//   e.g. PerCore<std::atomic<long>> hits; hits.Local().fetch_add(1, std::memory_order_relaxed);
+template<typename T>
+class PerCore : public PaddedArray<T> {
+public:
+    template<typename ... Args>
+    PerCore(Args&& ... args)
+        : PaddedArray<T>(Core::Count(), std::forward<Args>(args) ...) {}
+
+    // Element of the CPU the caller is running on
+    inline T& Local() { return (*this)[Core::Current() % this->Size()]; }
+};
+
+// One element per thread, found through an id given to each thread on first use
+// - Threads beyond size share elements (id % size), so size it to the thread count
+//   or use atomic elements
+template<typename T>
+class PerThread : public PaddedArray<T> {
+public:
+    // Sized for one thread per available CPU (requires Core::Init())
+    PerThread()
+        : PaddedArray<T>(Core::Count()) {}
+
+    template<typename ... Args>
+    PerThread(int size, Args&& ... args)
+        : PaddedArray<T>(size, std::forward<Args>(args) ...) {}
+
+    // Element of the calling thread
+    inline T& Local() { return (*this)[Core::ThreadId() % this->Size()]; }
+};
@@ -6,27 +6,91 @@
 ==============================================================================*/
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <pthread.h>
 
+#include "LockProfile.h"
+
 // Wraps pthread_rwlock_t for convenience
+// - name labels the lock in LockRegistry reports (lock profiling builds only),
+//   where hold times are only kept for writers
 class RWLock {
 public:
-    RWLock() {
+    RWLock() : RWLock(nullptr) {}
+
+    explicit RWLock(const char* name) {
         int err = pthread_rwlock_init(&m_rwlock, nullptr);
         assert(!err);
+#ifdef LIBTHREADING_LOCK_PROFILING
+        m_profile.SetName(name);
+#else
+        (void)name;
+#endif
     }
 
     ~RWLock() { pthread_rwlock_destroy(&m_rwlock); }
 
+#ifndef LIBTHREADING_LOCK_PROFILING
     bool TryRead() { return pthread_rwlock_tryrdlock(&m_rwlock) == 0; }
     bool TryWrite() { return pthread_rwlock_trywrlock(&m_rwlock) == 0; }
     void ReadLock() { pthread_rwlock_rdlock(&m_rwlock); }
     void WriteLock() { pthread_rwlock_wrlock(&m_rwlock); }
     void Unlock() { pthread_rwlock_unlock(&m_rwlock); }
+#else
+    bool TryRead() {
+        if (pthread_rwlock_tryrdlock(&m_rwlock)) return false;
+        m_profile.AcquiredShared(0, false);
+        return true;
+    }
+
+    bool TryWrite() {
+        if (pthread_rwlock_trywrlock(&m_rwlock)) return false;
+        acquiredWrite(0, false);
+        return true;
+    }
+
+    void ReadLock() {
+        if (pthread_rwlock_tryrdlock(&m_rwlock) == 0) {
+            m_profile.AcquiredShared(0, false);
+            return;
+        }
+        uint64_t start = LockProfile::Now();
+        pthread_rwlock_rdlock(&m_rwlock);
+        m_profile.AcquiredShared(start, true);
+    }
+
+    void WriteLock() {
+        if (pthread_rwlock_trywrlock(&m_rwlock) == 0) {
+            acquiredWrite(0, false);
+            return;
+        }
+        uint64_t start = LockProfile::Now();
+        pthread_rwlock_wrlock(&m_rwlock);
+        acquiredWrite(start, true);
+    }
+
+    void Unlock() {
+        // Only the writer can be unlocking while it holds the lock
+        if (m_writing.load(std::memory_order_relaxed)) {
+            m_writing.store(false, std::memory_order_relaxed);
+            m_profile.Released();
+        }
+        pthread_rwlock_unlock(&m_rwlock);
+    }
+#endif
 
 private:
     pthread_rwlock_t m_rwlock;
+#ifdef LIBTHREADING_LOCK_PROFILING
+    LockProfile m_profile{"RWLock"};
+    std::atomic<bool> m_writing{false};
+
+    void acquiredWrite(uint64_t start, bool contended) {
+        m_profile.Acquired(start, contended);
+        m_writing.store(true, std::memory_order_relaxed);
+    }
+#endif
 };
 
 // Sets rwlock for read and automatically cleans up after itself
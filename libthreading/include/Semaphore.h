@@ -0,0 +1,71 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Semaphore.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <cassert>
+
+#include "Futex.h"
+
+// Counting semaphore on a futex word
+// - Post() makes no syscall unless someone is asleep in Wait()
+// - Timed waits use MonotonicClock (CLOCK_MONOTONIC)
+class Semaphore {
+public:
+    Semaphore(int count = 0)
+        : m_count(count)
+    {
+        assert(count >= 0);
+    }
+
+    Semaphore(const Semaphore&) = delete;
+    Semaphore& operator=(const Semaphore&) = delete;
+
+    // Take a unit if one is available
+    bool TryWait() {
+        int count = m_count.load(std::memory_order_relaxed);
+        while (count > 0)
+            if (m_count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return true;
+        return false;
+    }
+
+    // Take a unit, sleeping until one is posted
+    void Wait() { wait(nullptr); }
+
+    // Returns false if no unit could be taken in time
+    bool WaitUntil(MonotonicClock::time_point deadline) { return wait(&deadline); }
+
+    template<class Rep, class Period>
+    bool WaitFor(std::chrono::duration<Rep, Period> timeout) { return WaitUntil(MonotonicClock::now() + timeout); }
+
+    // Add count units, waking as many sleepers
+    void Post(int count = 1) {
+        assert(count > 0);
+        m_count.fetch_add(count, std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_seq_cst)) Futex::Wake(&m_count, count);
+    }
+
+    inline int Count() { return m_count.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int> m_count; // Futex word
+    std::atomic<int> m_waiters{0};
+
+    bool wait(const MonotonicClock::time_point* deadline) {
+        while (!TryWait()) {
+            m_waiters.fetch_add(1, std::memory_order_seq_cst);
+            bool inTime = true;
+            if (m_count.load(std::memory_order_seq_cst) == 0)
+                inTime = Futex::Wait(&m_count, 0, deadline);
+            m_waiters.fetch_sub(1, std::memory_order_relaxed);
+
+            if (!inTime) return TryWait(); // Last chance after the timeout
+        }
+        return true;
+    }
+};
@@ -0,0 +1,117 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    SeqLock.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "Futex.h"
+#include "Mutex.h"
+
+// Sequence lock guarding a small trivially copyable T
+// - Readers never write shared memory: they copy the value and retry
+//   if a writer was active meanwhile, so reads scale with cores
+// - Writers are serialized by a FutexMutex and should be rare
+template<typename T>
+class SeqLock {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock only guards trivially copyable types");
+
+    SeqLock(const T& value = T()) { store(value); }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // Get a consistent copy of the value
+    T Read() const {
+        T value;
+        for (;;) {
+            uint32_t seq = m_seq.load(std::memory_order_acquire);
+            if (seq & 1) { // A write is in progress
+                CpuRelax();
+                continue;
+            }
+
+            load(value);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_seq.load(std::memory_order_relaxed) == seq) return value;
+        }
+    }
+
+    // Replace the value
+    void Write(const T& value) {
+        WriteLock();
+        store(value);
+        WriteUnlock();
+    }
+
+    // Begin/end an in place update (see ScopedSeqWrite)
+    void WriteLock() {
+        m_writer.Lock();
+        m_seq.store(m_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void WriteUnlock() {
+        m_seq.store(m_seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        m_writer.Unlock();
+    }
+
+private:
+    template<typename> friend class ScopedSeqWrite;
+
+    static const size_t Words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint32_t> m_seq{0}; // Odd while a write is in progress
+    FutexMutex m_writer;
+
+    // The value is kept in atomic words, so racing reads are well defined (and then discarded)
+    std::atomic<uint64_t> m_words[Words];
+
+    void load(T& value) const {
+        uint64_t words[Words];
+        for (size_t i = 0; i < Words; ++i)
+            words[i] = m_words[i].load(std::memory_order_relaxed);
+        memcpy(&value, words, sizeof(T));
+    }
+
+    void store(const T& value) {
+        uint64_t words[Words] = {};
+        memcpy(words, &value, sizeof(T));
+        for (size_t i = 0; i < Words; ++i)
+            m_words[i].store(words[i], std::memory_order_relaxed);
+    }
+};
+
+// Locks a SeqLock for writing, exposes a copy of its value to update in place,
+// and stores the copy back on destruction
+// e.g. { ScopedSeqWrite<Config> config(lock); config->limit = 10; }
+template<typename T>
+class ScopedSeqWrite {
+public:
+    ScopedSeqWrite(SeqLock<T>& lock)
+        : m_lock(&lock)
+    {
+        m_lock->WriteLock();
+        m_lock->load(m_value);
+    }
+
+    ~ScopedSeqWrite() {
+        m_lock->store(m_value);
+        m_lock->WriteUnlock();
+    }
+
+    T& operator*() { return m_value; }
+    T* operator->() { return &m_value; }
+
+private:
+    SeqLock<T>* m_lock;
+    T m_value;
+};
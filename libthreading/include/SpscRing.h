@@ -0,0 +1,193 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    SpscRing.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "Core.h"
+#include "Futex.h"
+
+// Wait-free single-producer/single-consumer ring buffer
+// - Exactly one thread may use the producer side (TryPush, Push, Reserve, Commit)
+//   and exactly one the consumer side (TryPop, Pop, Peek, Consume)
+// - Each side keeps its own index and a cached copy of the other side's index on
+//   its own cache line, so the shared indices are only read when the cache runs out
+// - Batches are written in place with Reserve()/Commit() and read with Peek()/Consume(),
+//   publishing a whole batch with a single store
+// - Push()/Pop() sleep on a futex while full/empty, waking costs a syscall
+//   only when the other side is actually asleep
+template<typename T>
+class SpscRing {
+public:
+    // capacity must be a power of two
+    SpscRing(size_t capacity)
+        : m_mask(capacity - 1), m_items(new T[capacity])
+    {
+        assert(capacity >= 2 && !(capacity & (capacity-1)));
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    inline size_t Capacity() const { return m_mask + 1; }
+
+    // -- Producer side
+
+    // Get up to max contiguous free slots to fill, returns how many (0 if full)
+    // - Slots hold previously consumed (or default constructed) items, assign into them
+    size_t Reserve(T*& slots, size_t max = (size_t)-1) {
+        size_t tail = m_prod.tail;
+        size_t want = std::min(max, Capacity() - (tail & m_mask)); // Up to the end of the buffer
+        size_t free = Capacity() - (tail - m_prod.cachedHead);
+        if (free < want) {
+            // Refresh our view of the consumer only when it seems to hold us back
+            m_prod.cachedHead = m_head.load(std::memory_order_acquire);
+            free = Capacity() - (tail - m_prod.cachedHead);
+        }
+
+        slots = &m_items[tail & m_mask];
+        return std::min(free, want);
+    }
+
+    // Publish the first n reserved slots to the consumer
+    void Commit(size_t n) {
+        m_prod.tail += n;
+        m_tail.store(m_prod.tail, std::memory_order_release);
+        wake(m_readable, m_consumerAsleep);
+    }
+
+    bool TryPush(const T& item) { return tryPush(item); }
+    bool TryPush(T&& item) { return tryPush(std::move(item)); }
+
+    // Add item, sleeping while full, returns false if the ring is closed
+    bool Push(T item) {
+        while (!tryPush(std::move(item))) {
+            if (Closed()) return false;
+            park(m_writable, m_producerAsleep, [this]() { return !full() || Closed(); });
+        }
+        return true;
+    }
+
+    // Tell the consumer no more items will come (wakes it if asleep)
+    void Close() {
+        m_closed.store(true, std::memory_order_seq_cst);
+        m_readable.fetch_add(1, std::memory_order_seq_cst);
+        m_writable.fetch_add(1, std::memory_order_seq_cst);
+        Futex::WakeAll(&m_readable);
+        Futex::WakeAll(&m_writable);
+    }
+
+    inline bool Closed() { return m_closed.load(std::memory_order_acquire); }
+
+    // -- Consumer side
+
+    // Get up to max contiguous items to read, returns how many (0 if empty)
+    size_t Peek(T*& items, size_t max = (size_t)-1) {
+        size_t head = m_cons.head;
+        size_t want = std::min(max, Capacity() - (head & m_mask)); // Up to the end of the buffer
+        size_t available = m_cons.cachedTail - head;
+        if (available < want) {
+            // Refresh our view of the producer only when it seems to hold us back
+            m_cons.cachedTail = m_tail.load(std::memory_order_acquire);
+            available = m_cons.cachedTail - head;
+        }
+
+        items = &m_items[head & m_mask];
+        return std::min(available, want);
+    }
+
+    // Hand the first n peeked slots back to the producer
+    void Consume(size_t n) {
+        m_cons.head += n;
+        m_head.store(m_cons.head, std::memory_order_release);
+        wake(m_writable, m_producerAsleep);
+    }
+
+    // Take the oldest item into item, returns false if empty
+    bool TryPop(T& item) {
+        T* items;
+        if (!Peek(items, 1)) return false;
+        item = std::move(*items);
+        Consume(1);
+        return true;
+    }
+
+    // Take the oldest item, sleeping while empty,
+    // returns false once the ring is closed and drained
+    bool Pop(T& item) {
+        while (!TryPop(item)) {
+            if (Closed() && empty()) return false;
+            park(m_readable, m_consumerAsleep, [this]() { return !empty() || Closed(); });
+        }
+        return true;
+    }
+
+private:
+    const size_t m_mask;
+    std::unique_ptr<T[]> m_items;
+
+    // Shared indices, each written by one side only
+    alignas(Core::CacheLine) std::atomic<size_t> m_head{0}; // Next item to read
+    alignas(Core::CacheLine) std::atomic<size_t> m_tail{0}; // Next slot to write
+
+    // Private state of each side
+    struct alignas(Core::CacheLine) Producer {
+        size_t tail = 0;
+        size_t cachedHead = 0;
+    } m_prod;
+
+    struct alignas(Core::CacheLine) Consumer {
+        size_t head = 0;
+        size_t cachedTail = 0;
+    } m_cons;
+
+    // Futex words bumped on publish/consume, and whether the other side sleeps on them
+    alignas(Core::CacheLine) std::atomic<int> m_readable{0};
+    std::atomic<int> m_consumerAsleep{0};
+    alignas(Core::CacheLine) std::atomic<int> m_writable{0};
+    std::atomic<int> m_producerAsleep{0};
+
+    std::atomic<bool> m_closed{false};
+
+    template<typename U>
+    bool tryPush(U&& item) {
+        if (Closed()) return false;
+
+        T* slot;
+        if (!Reserve(slot, 1)) return false;
+        *slot = std::forward<U>(item);
+        Commit(1);
+        return true;
+    }
+
+    bool empty() { return m_tail.load(std::memory_order_seq_cst) == m_cons.head; }
+    bool full() { return m_prod.tail - m_head.load(std::memory_order_seq_cst) == Capacity(); }
+
+    // Sleep on word unless ready() already holds once we are marked asleep
+    template<typename Ready>
+    void park(std::atomic<int>& word, std::atomic<int>& asleep, Ready ready) {
+        int seq = word.load(std::memory_order_acquire);
+        asleep.store(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!ready()) Futex::Wait(&word, seq);
+        asleep.store(0, std::memory_order_relaxed);
+    }
+
+    // Wake the other side, without a syscall unless it is asleep
+    void wake(std::atomic<int>& word, std::atomic<int>& asleep) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (asleep.load(std::memory_order_relaxed)) {
+            word.fetch_add(1, std::memory_order_release);
+            Futex::Wake(&word);
+        }
+    }
+};
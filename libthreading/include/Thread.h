@@ -6,9 +6,23 @@
 ==============================================================================*/
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
 #include <memory>
+#include <new>
 #include <pthread.h>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "Futex.h"
+#include "Mutex.h"
 
 // Macros used basically to hide "void*"-based function header from library user (optional of course)
 // - Also allows abstraction of this library so an API other than
@@ -22,104 +36,406 @@
 // the constructed argument is deleted and a running
 // thread may not work as expected.
 // i.e. don't let Thread objects go out of scope before their completion
+// (Threads running a callable, see Thread<Ret,void>, instead join on destruction)
+
+class Completion;
+
+// Creation attributes of a Thread, built by chaining setters, e.g.
+//      Thread<void> t(ThreadAttr(cpu).StackSize(64*1024).Name("worker"), task);
+// - A plain int converts to a ThreadAttr with only that CPU set (-1 for any CPU)
+// - Unset attributes keep the pthread defaults (8 MB stack, inherited scheduling)
+class ThreadAttr {
+public:
+    ThreadAttr(int cpu = -1) : m_cpu(cpu) { m_name[0] = '\0'; }
+
+    // CPU to pin the thread to (-1 for any)
+    ThreadAttr& Cpu(int cpu) { m_cpu = cpu; return *this; }
+
+    // Size of the usable stack, the stack then comes from the StackCache
+    ThreadAttr& StackSize(size_t bytes) { m_stackSize = bytes; return *this; }
+
+    // Size of the inaccessible region below the stack (0 for none)
+    ThreadAttr& GuardSize(size_t bytes) { m_guardSize = bytes; m_guardSet = true; return *this; }
+
+    // Scheduling policy (e.g. SCHED_FIFO, SCHED_RR, SCHED_BATCH) and static priority
+    // - Falls back to the inherited scheduling if the caller lacks the privilege
+    ThreadAttr& Schedule(int policy, int priority = 0) { m_policy = policy; m_priority = priority; return *this; }
+
+    // Name shown by ps, top and debuggers (truncated to 15 characters)
+    ThreadAttr& Name(const char* name) {
+        snprintf(m_name, sizeof(m_name), "%s", name ? name : "");
+        return *this;
+    }
+
+    // Touch every stack page before the thread starts, so it never page faults on its stack
+    // (only for a StackSize stack)
+    ThreadAttr& Prefault(bool prefault = true) { m_prefault = prefault; return *this; }
+
+    inline int Cpu() const { return m_cpu; }
+    inline size_t StackSize() const { return m_stackSize; }
+    inline const char* Name() const { return m_name; }
+
+private:
+    friend class ThreadBase;
+
+    int m_cpu;
+    size_t m_stackSize = 0; // 0 for the pthread default
+    size_t m_guardSize = 0;
+    bool m_guardSet = false;
+    int m_policy = -1; // -1 to inherit
+    int m_priority = 0;
+    bool m_prefault = false;
+    char m_name[16]; // pthread_setname_np limit, including the terminator
+};
+
+// Recycles thread stacks, so short-lived threads skip the mmap/munmap
+// (and page faults) of a fresh stack on every creation
+// - Stacks are reused for requests of the same size and guard size
+// - Keeps at most Limit() bytes of idle stacks, unmapping the rest
+class StackCache {
+public:
+    struct Stack {
+        void* base = nullptr; // Start of the mapping (guard pages first)
+        size_t size = 0;      // Usable bytes, above the guard
+        size_t guard = 0;
+    };
+
+    static Stack Acquire(size_t size, size_t guard, bool prefault);
+
+    // Only once no thread runs on it (i.e. after joining)
+    static void Release(const Stack& stack);
+
+    static void SetLimit(size_t bytes);
+    static size_t Limit();
+
+    // Unmap every idle stack
+    static void Trim();
+
+    // Number of idle stacks kept
+    static size_t Cached();
+
+    // Start of the usable part of stack
+    static inline void* Usable(const Stack& stack) { return (char*)stack.base + stack.guard; }
+
+private:
+    static Mutex m_lock;
+    static std::vector<Stack> m_idle;
+    static size_t m_idleBytes;
+    static size_t m_limit;
+
+    static void unmap(const Stack& stack);
+};
+
+// Shared pthread handling for every Thread type
+// - Runs the task through a wrapper so that finishing (by return or by
+//   THREAD_RETURN's pthread_exit) can be waited on without joining
+class ThreadBase {
+public:
+    ThreadBase(const ThreadBase&) = delete;
+    ThreadBase& operator=(const ThreadBase&) = delete;
+
+    // Has the task finished? (Join() will then not block)
+    bool Done() { return m_state.load(std::memory_order_acquire) == FINISHED; }
+
+    // Sleep until the task has finished, without joining
+    void Wait() {
+        int state = m_state.load(std::memory_order_acquire);
+        while (state != FINISHED) {
+            // Let the thread know it must wake us when it finishes
+            if (state == RUNNING &&
+                    !m_state.compare_exchange_weak(state, WAITED, std::memory_order_acquire))
+                continue;
+            Futex::Wait(&m_state, WAITED);
+            state = m_state.load(std::memory_order_acquire);
+        }
+    }
+
+    // Report tag to completion once the task finishes (see Completion)
+    // - A thread can notify at most one Completion
+    void NotifyOn(Completion& completion, int tag);
+
+protected:
+    bool m_running;
+    ThreadAttr m_attr;
+    void*(*m_task)(void*);
+    pthread_t m_thread;
+
+    ThreadBase(const ThreadAttr& attr, void*(*task)(void*))
+        : m_running(false), m_attr(attr), m_task(task) {}
+
+    // Create the pthread object, running m_task(arg)
+    void create(void* arg);
+
+    // The pthread was joined, so its stack can be reused
+    void joined() {
+        m_running = false;
+        if (m_stack.base) {
+            StackCache::Release(m_stack);
+            m_stack = StackCache::Stack();
+        }
+    }
+
+private:
+    enum { RUNNING, WAITED, FINISHED };
+
+    void* m_taskArg;
+    StackCache::Stack m_stack; // Only set for a StackSize stack
+    std::atomic<int> m_state{RUNNING}; // Futex word
+    std::atomic<Completion*> m_listener{nullptr};
+    int m_tag = -1;
+
+    // Marks m_listener once the thread has finished
+    static Completion* finishedMark() { return reinterpret_cast<Completion*>(uintptr_t(1)); }
+
+    void finish();
+
+    // Entry point of every thread, wraps m_task
+    static void* run(void* self) {
+        // Finishes on scope exit so that pthread_exit(..) (which unwinds) is covered too
+        struct Finisher {
+            ThreadBase* thread;
+            ~Finisher() { thread->finish(); }
+        } finisher{(ThreadBase*)self};
+
+        // Named from within, so the task never runs under the creator's name
+        if (finisher.thread->m_attr.m_name[0]) pthread_setname_np(pthread_self(), finisher.thread->m_attr.m_name);
+
+        return finisher.thread->m_task(finisher.thread->m_taskArg);
+    }
+};
+
+// Collects finished threads in the order they finish
+// - Waiting sleeps on a futex rather than polling each thread
+// e.g.
+//      Completion done;
+//      for (int i = 0; i < n; ++i) done.Watch(*threads[i], i);
+//      for (int i; (i = done.WaitAny()) >= 0;) use(threads[i]->Join());
+class Completion {
+public:
+    // Report tag from WaitAny() once thread finishes
+    void Watch(ThreadBase& thread, int tag) {
+        {
+            ScopedMutex guard(m_lock);
+            ++m_watched;
+        }
+        thread.NotifyOn(*this, tag);
+    }
+
+    // Sleep until a watched thread finishes and return its tag,
+    // or -1 when every watched thread has already been reported
+    int WaitAny() {
+        ScopedMutex guard(m_lock);
+        for (;;) {
+            if (m_reported < (int)m_order.size()) return m_order[m_reported++];
+            if (m_reported == m_watched) return -1;
+
+            int seq = m_seq.load(std::memory_order_relaxed);
+            ++m_waiting;
+            m_lock.Unlock();
+            Futex::Wait(&m_seq, seq);
+            m_lock.Lock();
+            --m_waiting;
+        }
+    }
+
+    // Sleep until every watched thread has finished
+    void WaitAll() { while (WaitAny() >= 0); }
+
+    // Number of watched threads not yet reported by WaitAny()
+    int Remaining() {
+        ScopedMutex guard(m_lock);
+        return m_watched - m_reported;
+    }
+
+private:
+    friend ThreadBase;
+
+    Mutex m_lock;
+    std::vector<int> m_order; // Tags in order of completion
+    std::atomic<int> m_seq{0}; // Futex word, bumped on every post
+    int m_watched = 0;
+    int m_reported = 0;
+    int m_waiting = 0;
+
+    void post(int tag) {
+        // Wake while holding the lock, so the Completion cannot be
+        // destroyed by the waiter before we are done touching it
+        ScopedMutex guard(m_lock);
+        m_order.push_back(tag);
+        m_seq.fetch_add(1, std::memory_order_relaxed);
+        if (m_waiting) Futex::WakeAll(&m_seq);
+    }
+};
+
+inline void ThreadBase::NotifyOn(Completion& completion, int tag) {
+    m_tag = tag;
+    Completion* expected = nullptr;
+    if (!m_listener.compare_exchange_strong(expected, &completion, std::memory_order_acq_rel)) {
+        // Already finished, so report straight away
+        assert(expected == finishedMark());
+        completion.post(tag);
+    }
+}
+
+inline void ThreadBase::finish() {
+    Completion* listener = m_listener.exchange(finishedMark(), std::memory_order_acq_rel);
+    if (listener) listener->post(m_tag);
+
+    // Last touch of this object, a waiter may destroy it right after
+    if (m_state.exchange(FINISHED, std::memory_order_release) == WAITED)
+        Futex::WakeAll(&m_state);
+}
+
+inline void ThreadBase::create(void* arg) {
+    m_taskArg = arg;
+
+    pthread_attr_t attr;
+
+    // Explicitly set thread as joinable
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    if (m_attr.m_cpu >= 0) {
+        // Set thread to run on a particular cpu
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(m_attr.m_cpu, &cpus);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
+    }
+
+    if (m_attr.m_stackSize) {
+        // pthreads ignores the guard size of a caller provided stack, the cache maps its own
+        m_stack = StackCache::Acquire(m_attr.m_stackSize, m_attr.m_guardSet ? m_attr.m_guardSize : (size_t)sysconf(_SC_PAGESIZE), m_attr.m_prefault);
+        pthread_attr_setstack(&attr, StackCache::Usable(m_stack), m_stack.size);
+    } else if (m_attr.m_guardSet) {
+        pthread_attr_setguardsize(&attr, m_attr.m_guardSize);
+    }
+
+    if (m_attr.m_policy >= 0) {
+        sched_param param;
+        param.sched_priority = m_attr.m_priority;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, m_attr.m_policy);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    int err = pthread_create(&m_thread, &attr, run, (void*) this);
+    if (err == EPERM && m_attr.m_policy >= 0) {
+        // Not allowed to pick the scheduling (e.g. real-time without CAP_SYS_NICE), so inherit it
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        err = pthread_create(&m_thread, &attr, run, (void*) this);
+    }
+
+    // Terminate on an error
+    assert(!err);
+
+    m_running = true;
+
+    pthread_attr_destroy(&attr);
+}
+
+
+// Holds the return value of a finished task
+// - Kept in place so Ret need not be default constructible
+template<typename Ret>
+class TaskResult {
+public:
+    ~TaskResult() { if (m_set) Get()->~Ret(); }
+
+    template<typename Task>
+    void Run(Task& task) {
+        new (&m_storage) Ret(task());
+        m_set = true;
+    }
 
+    Ret* Get() { return reinterpret_cast<Ret*>(&m_storage); }
+    Ret Take() { return std::move(*Get()); }
+
+private:
+    typename std::aligned_storage<sizeof(Ret), alignof(Ret)>::type m_storage;
+    bool m_set = false;
+};
+
+// (void specialization, there is nothing to store)
+template<>
+class TaskResult<void> {
+public:
+    template<typename Task>
+    void Run(Task& task) { task(); }
+
+    void* Get() { return nullptr; }
+    void Take() {}
+};
+
+// Result type of calling a stored (decayed) Task with stored Args
+template<typename Task, typename ... Args>
+using CallResult = decltype(std::declval<typename std::decay<Task>::type&>()(
+    std::declval<typename std::decay<Args>::type&>() ...));
 
 // Wraps pthread_t for convenience
 // - Ret is the return type of wrapped thread task
-// - Arg is the input argument of wrapped thread task
-template<typename Ret, class Arg>
-class Thread {
+// - Arg is the input argument of wrapped thread task (void for none, or for callables)
+template<typename Ret, class Arg = void>
+class Thread : public ThreadBase {
 public:
     Thread(void*(*task)(void*), Arg& arg); // Construct given Arg directly
-    Thread(int cpu, void*(*task)(void*), Arg& arg); // (CPU affinity version)
+    Thread(const ThreadAttr& attr, void*(*task)(void*), Arg& arg); // (CPU affinity/attribute version)
 
     // Construct given Arg indirectly (using its constructor Args)
     template<typename ... Args>
     Thread(void*(*task)(void*), Args&& ... args);
-    // (CPU affinity version)
+    // (CPU affinity/attribute version)
     template<typename ... Args>
-    Thread(int cpu, void*(*task)(void*), Args&& ... args);
+    Thread(const ThreadAttr& attr, void*(*task)(void*), Args&& ... args);
 
     Ret* Join(); // Get return value from thread (waits for thread if not finished)
     bool ResultPending(); // Is the thread finished with execution? (TryJoin() basically)
 
 private:
     Ret* m_ret;
-    bool m_running;
-    int m_cpu;
-    void*(*m_task)(void*);
-    pthread_t m_thread;
 
     // We keep the argument local, so be sure not to destroy Thread object before it finishes
     std::shared_ptr<Arg> m_arg;
-
-    void create();
 };
 
 // Constructs thread from task and argument of necessary input type
 template<typename Ret, class Arg>
 Thread<Ret,Arg>::Thread(void*(*task)(void*), Arg& arg)
-    : m_ret(nullptr), m_running(false), m_cpu(-1), m_task(task)
+    : ThreadBase(-1, task), m_ret(nullptr)
 {
     m_arg = std::make_shared<Arg>(arg);
-    create();
+    create((void*) m_arg.get());
 }
 
 // Constructs thread from task and argument of necessary input type
-//      while allowing for a specific CPU to be specified
+//      while allowing for a specific CPU (or other attributes) to be specified
 template<typename Ret, class Arg>
-Thread<Ret,Arg>::Thread(int cpu, void*(*task)(void*), Arg& arg)
-    : m_ret(nullptr), m_running(false), m_cpu(cpu), m_task(task)
+Thread<Ret,Arg>::Thread(const ThreadAttr& attr, void*(*task)(void*), Arg& arg)
+    : ThreadBase(attr, task), m_ret(nullptr)
 {
     m_arg = std::make_shared<Arg>(arg);
-    create();
+    create((void*) m_arg.get());
 }
 
 // Constructs thread from task and variable arguments to construct necessary input type
 template<typename Ret, class Arg>
 template<typename ... Args>
 Thread<Ret,Arg>::Thread(void*(*task)(void*), Args&& ... args)
-    : m_ret(nullptr), m_running(false), m_cpu(-1), m_task(task)
+    : ThreadBase(-1, task), m_ret(nullptr)
 {
     m_arg = std::make_shared<Arg>(std::forward<Args>(args) ...);
-    create();
+    create((void*) m_arg.get());
 }
 
 // Constructs thread from task and variable arguments to construct necessary input type
-//      while allowing for a specific CPU to be specified
+//      while allowing for a specific CPU (or other attributes) to be specified
 template<typename Ret, class Arg>
 template<typename ... Args>
-Thread<Ret,Arg>::Thread(int cpu, void*(*task)(void*), Args&& ... args)
-    : m_ret(nullptr), m_running(false), m_cpu(cpu), m_task(task)
+Thread<Ret,Arg>::Thread(const ThreadAttr& attr, void*(*task)(void*), Args&& ... args)
+    : ThreadBase(attr, task), m_ret(nullptr)
 {
     m_arg = std::make_shared<Arg>(std::forward<Args>(args) ...);
-    create();
-}
-
-// Create the pthread object
-template<typename Ret, class Arg>
-void Thread<Ret,Arg>::create() {
-    pthread_attr_t attr;
-
-    // Explicitly set thread as joinable
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-
-    if (m_cpu >= 0) {
-        // Set thread to run on a particular cpu
-        cpu_set_t cpus;
-        CPU_ZERO(&cpus);
-        CPU_SET(m_cpu, &cpus);
-        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
-    }
-
-    // Create the thread and terminate on an error
-    int err = pthread_create(&m_thread, &attr, m_task, (void*) m_arg.get());
-    assert(!err);
-
-    m_running = true;
-
-    pthread_attr_destroy(&attr);
+    create((void*) m_arg.get());
 }
 
 // Wait for thread to terminate and pass return value
@@ -130,7 +446,7 @@ Ret* Thread<Ret,Arg>::Join() {
         int err = pthread_join(m_thread, &status);
         assert(!err);
 
-        m_running = false;
+        joined();
         m_ret = (Ret*) status;
     }
     return m_ret;
@@ -141,7 +457,7 @@ template<typename Ret, class Arg>
 bool Thread<Ret,Arg>::ResultPending() {
     // Also stores the return value so it can be checked later
     if (m_running && !pthread_tryjoin_np(m_thread, (void**)(&m_ret))) {
-        m_running = false;
+        joined();
         return true;
     }
     return false;
@@ -149,52 +465,148 @@ bool Thread<Ret,Arg>::ResultPending() {
 
 // -------------------------------------------------
 // Thread specialization for void argument
+// - Either runs a raw void*(*)(void*) task without argument,
+// - or runs any callable with its arguments, e.g.
+//      Thread<long> t([](int *arr, int n) { ... return sum; }, arr, n);
+//      long sum = t.Get();
+//   The callable and arguments are stored inside the Thread object
+//   (on the heap only if larger than InlineSize) and the result is returned by value.
 
 template<typename Ret>
-class Thread<Ret,void> {
+class Thread<Ret,void> : public ThreadBase {
 public:
-    Thread(void*(*task)(void*))
-        : m_ret(nullptr), m_running(false), m_cpu(-1), m_task(task)
-    { create(); }
+    static const size_t InlineSize = 64;
 
-    Thread(int cpu, void*(*task)(void*))
-        : m_ret(nullptr), m_running(false), m_cpu(cpu), m_task(task)
-    { create(); }
+    Thread(void*(*task)(void*))
+        : ThreadBase(-1, task), m_ret(nullptr)
+    { create(nullptr); }
+
+    Thread(const ThreadAttr& attr, void*(*task)(void*))
+        : ThreadBase(attr, task), m_ret(nullptr)
+    { create(nullptr); }
+
+    // Construct from any callable and the arguments to call it with
+    template<typename Task, typename ... Args, typename = CallResult<Task, Args...>,
+             typename = typename std::enable_if<!std::is_convertible<Task, void*(*)(void*)>::value>::type>
+    Thread(Task&& task, Args&& ... args)
+        : Thread(ThreadAttr(), std::forward<Task>(task), std::forward<Args>(args) ...) {}
+
+    // (CPU affinity/attribute version)
+    template<typename Task, typename ... Args, typename = CallResult<Task, Args...>,
+             typename = typename std::enable_if<!std::is_convertible<Task, void*(*)(void*)>::value>::type>
+    Thread(const ThreadAttr& attr, Task&& task, Args&& ... args);
+
+    // A callable thread must finish before its stored callable is destroyed
+    ~Thread() {
+        if (m_call) {
+            Join();
+            m_destroy(m_call);
+        }
+    }
 
-    Ret* Join();
+    Ret* Join(); // Get return value from thread (waits for thread if not finished)
     bool TryJoin(Ret** ret);
 
+    // Get return value by value from a callable thread (waits for thread if not finished)
+    // - Moves the result out, so call at most once
+    Ret Get() {
+        assert(m_call);
+        Join();
+        return m_result.Take();
+    }
+
 private:
     Ret* m_ret;
-    bool m_running = false;
-    int m_cpu;
-    void*(*m_task)(void*);
-    pthread_t m_thread;
 
-    void create();
+    // Storage for a callable and its arguments
+    typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type m_inline;
+    void* m_call = nullptr; // Points at m_inline or a heap allocation
+    void (*m_destroy)(void*) = nullptr;
+    void (*m_invoke)(Thread*) = nullptr;
+    TaskResult<Ret> m_result;
+
+    // A callable bound to its (decayed) arguments
+    template<typename Task, typename ... Args>
+    struct Bound {
+        Task task;
+        std::tuple<Args...> args;
+
+        template<typename T, typename ... A>
+        Bound(T&& task, A&& ... args)
+            : task(std::forward<T>(task)), args(std::forward<A>(args) ...) {}
+
+        Ret operator()() { return call(std::is_void<Ret>(), std::index_sequence_for<Args...>{}); }
+
+        template<size_t ... I>
+        Ret call(std::false_type, std::index_sequence<I...>) { return task(std::get<I>(args) ...); }
+
+        // (a void thread discards whatever the callable returns)
+        template<size_t ... I>
+        void call(std::true_type, std::index_sequence<I...>) { task(std::get<I>(args) ...); }
+    };
+
+    template<typename B, typename ... A>
+    void bind(std::true_type /*inline*/, A&& ... args) {
+        m_call = new (&m_inline) B(std::forward<A>(args) ...);
+        m_destroy = [](void* call) { ((B*)call)->~B(); };
+    }
+
+    template<typename B, typename ... A>
+    void bind(std::false_type /*heap*/, A&& ... args) {
+        m_call = new B(std::forward<A>(args) ...);
+        m_destroy = [](void* call) { delete (B*)call; };
+    }
+
+    template<typename B>
+    static void invoke(Thread* self) { self->m_result.Run(*(B*)self->m_call); }
+
+    // Thread entry point for callable threads
+    static void* run_call(void* self) {
+        ((Thread*)self)->m_invoke((Thread*)self);
+        return nullptr;
+    }
 };
 
 template<typename Ret>
-void Thread<Ret,void>::create() {
-    pthread_attr_t attr;
+template<typename Task, typename ... Args, typename, typename>
+Thread<Ret,void>::Thread(const ThreadAttr& attr, Task&& task, Args&& ... args)
+    : ThreadBase(attr, run_call), m_ret(nullptr)
+{
+    using B = Bound<typename std::decay<Task>::type, typename std::decay<Args>::type ...>;
+    static_assert(std::is_convertible<CallResult<Task, Args...>, Ret>::value || std::is_void<Ret>::value,
+        "the callable's result must convert to Ret");
 
-    // Explicitly set thread as joinable
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    // Small callables live inside the Thread, saving an allocation
+    using Fits = std::integral_constant<bool, sizeof(B) <= InlineSize && alignof(B) <= alignof(std::max_align_t)>;
+    bind<B>(Fits(), std::forward<Task>(task), std::forward<Args>(args) ...);
+    m_invoke = invoke<B>;
 
-    if (m_cpu >= 0) {
-        // Set thread to run on a particular cpu
-        cpu_set_t cpus;
-        CPU_ZERO(&cpus);
-        CPU_SET(m_cpu, &cpus);
-        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
-    }
+    create((void*) this);
+}
 
-    // Create the thread and terminate on an error
-    int err = pthread_create(&m_thread, &attr, m_task, nullptr);
-    assert(!err);
+// Wait for thread to terminate and pass return value
+template<typename Ret>
+Ret* Thread<Ret,void>::Join() {
+    if (m_running) {
+        void *status;
+        int err = pthread_join(m_thread, &status);
+        assert(!err);
 
-    m_running = true;
+        joined();
+        m_ret = m_call ? m_result.Get() : (Ret*) status;
+    }
+    return m_ret;
+}
 
-    pthread_attr_destroy(&attr);
+// Join the thread only if it has finished, storing its return value in ret
+template<typename Ret>
+bool Thread<Ret,void>::TryJoin(Ret** ret) {
+    void *status;
+    if (m_running && !pthread_tryjoin_np(m_thread, &status)) {
+        joined();
+        m_ret = m_call ? m_result.Get() : (Ret*) status;
+        if (ret) *ret = m_ret;
+        return true;
+    }
+    return false;
 }
@@ -0,0 +1,208 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    ThreadPool.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <cassert>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Condition.h"
+#include "Core.h"
+#include "Mutex.h"
+#include "Thread.h"
+
+class ThreadPool;
+
+// Handle to a task submitted to a ThreadPool
+// - Ret is the return type of the submitted task
+template<typename Ret>
+class PoolTask {
+public:
+    // Get return value from task (waits for task if not finished)
+    // - The pointer stays valid for as long as the handle is kept
+    auto Wait() -> decltype(std::declval<TaskResult<Ret>&>().Get()) {
+        ScopedMutex guard(m_lock);
+        while (!m_finished) m_done.Wait(m_lock);
+        return m_result.Get();
+    }
+
+    // Is the task finished with execution?
+    bool Done() {
+        ScopedMutex guard(m_lock);
+        return m_finished;
+    }
+
+private:
+    friend ThreadPool;
+
+    Mutex m_lock{"PoolTask::m_lock"};
+    Condition m_done{"PoolTask::m_done"};
+    bool m_finished = false;
+    TaskResult<Ret> m_result;
+
+    template<typename Task>
+    void run(Task& task) {
+        m_result.Run(task);
+
+        ScopedMutex guard(m_lock);
+        m_finished = true;
+        m_done.Broadcast();
+    }
+};
+
+// Keeps a fixed set of worker threads alive and runs submitted tasks on them,
+// so repeated parallel work does not pay for thread creation each time
+class ThreadPool {
+public:
+    // Start num_threads workers, optionally pinning worker i to
+    // available CPU (i % Core::Count()) (requires Core::Init())
+    ThreadPool(int num_threads, bool pinned = false) {
+        assert(num_threads > 0);
+        m_workers.reserve(num_threads);
+        m_local.resize(num_threads);
+        for (int i = 0; i < num_threads; ++i) {
+            int cpu = pinned ? (int)(i % Core::Count()) : -1;
+            m_cpus.push_back(cpu);
+            m_workers.push_back(Core::MakeThread<void,WorkerArg>(cpu, worker_task, this, i));
+        }
+    }
+
+    // Start num_threads workers, pinning worker i where policy places it (see Core::Place)
+    ThreadPool(int num_threads, Placement policy) {
+        assert(num_threads > 0);
+        m_workers.reserve(num_threads);
+        m_local.resize(num_threads);
+        for (int i = 0; i < num_threads; ++i) {
+            m_cpus.push_back(Core::Place(policy, i));
+            m_workers.push_back(Core::MakeThread<void,WorkerArg>(m_cpus[i], worker_task, this, i));
+        }
+    }
+
+    // Finishes all queued tasks, then joins the workers
+    ~ThreadPool() {
+        {
+            ScopedMutex guard(m_lock);
+            m_stopping = true;
+            m_pending.Broadcast();
+        }
+        for (auto& worker : m_workers)
+            worker->Join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    inline int Size() { return (int)m_workers.size(); }
+
+    // Available CPU index (see Core) worker is pinned to, or -1 if unpinned
+    inline int WorkerCpu(int worker) { return m_cpus[worker]; }
+
+    // Queue a callable taking no arguments, returns a handle to its result
+    template<typename Task>
+    auto Submit(Task&& task) -> std::shared_ptr<PoolTask<decltype(task())>> {
+        return submit(m_queue, false, std::forward<Task>(task));
+    }
+
+    // Queue a callable to run on a particular worker (0 <= worker < Size())
+    // - Lets repeated calls process the same data on the same CPU (and NUMA node)
+    template<typename Task>
+    auto SubmitTo(int worker, Task&& task) -> std::shared_ptr<PoolTask<decltype(task())>> {
+        assert(worker >= 0 && worker < Size());
+        return submit(m_local[worker], true, std::forward<Task>(task));
+    }
+
+    // Run one queued task on the calling thread, returns false if none was found
+    // - Only pool workers may help (taking their own targeted tasks first), other threads always return false
+    bool RunOne() {
+        if (!IsWorker()) return false;
+
+        std::function<void()> task;
+        {
+            ScopedMutex guard(m_lock);
+            Queue& local = m_local[m_current->index];
+            Queue& queue = local.empty() ? m_queue : local;
+            if (queue.empty()) return false;
+
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+        task();
+        return true;
+    }
+
+    // Is the calling thread one of this pool's workers?
+    inline bool IsWorker() { return m_current && m_current->pool == this; }
+
+private:
+    typedef std::deque<std::function<void()>> Queue;
+
+    struct WorkerArg {
+        ThreadPool* pool;
+        int index;
+
+        WorkerArg(ThreadPool* pool, int index)
+            : pool(pool), index(index) {}
+    };
+
+    Mutex m_lock{"ThreadPool::m_lock"}; // Protects the queues and stop flag
+    Condition m_pending{"ThreadPool::m_pending"}; // Signaled when work is queued or the pool stops
+    Queue m_queue; // Tasks for any worker
+    std::vector<Queue> m_local; // Tasks for one particular worker
+    bool m_stopping = false;
+
+    std::vector<std::shared_ptr<Thread<void,WorkerArg>>> m_workers;
+    std::vector<int> m_cpus;
+
+    static thread_local WorkerArg* m_current; // Calling worker (of any pool), if any
+
+    template<typename Task>
+    auto submit(Queue& queue, bool targeted, Task&& task) -> std::shared_ptr<PoolTask<decltype(task())>> {
+        using Ret = decltype(task());
+        auto handle = std::make_shared<PoolTask<Ret>>();
+
+        typename std::decay<Task>::type body(std::forward<Task>(task));
+        {
+            ScopedMutex guard(m_lock);
+            queue.emplace_back([handle, body]() mutable { handle->run(body); });
+
+            // Any worker may take a shared task, but only one worker a targeted one
+            if (targeted) m_pending.Broadcast();
+            else m_pending.Signal();
+        }
+        return handle;
+    }
+
+    // Blocks until a task is available, returns false once stopping with empty queues
+    bool next(int worker, std::function<void()>& task) {
+        ScopedMutex guard(m_lock);
+        Queue& local = m_local[worker];
+        while (local.empty() && m_queue.empty() && !m_stopping)
+            m_pending.Wait(m_lock);
+
+        Queue& queue = local.empty() ? m_queue : local;
+        if (queue.empty()) return false;
+
+        task = std::move(queue.front());
+        queue.pop_front();
+        return true;
+    }
+
+    // Define the worker function:
+    // --  void* worker_task(WorkerArg* arg)
+    static THREAD_FUNC(worker_task, void,WorkerArg) {
+        m_current = arg;
+
+        std::function<void()> task;
+        while (arg->pool->next(arg->index, task))
+            task();
+        THREAD_RETURN(nullptr);
+    }
+};
@@ -0,0 +1,109 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    TimerWheel.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Condition.h"
+#include "Futex.h"
+#include "Mutex.h"
+#include "Thread.h"
+
+// Runs deadline callbacks on one timer thread, e.g.
+//      TimerWheel timers;
+//      auto id = timers.After(std::chrono::milliseconds(5), [&]() { event.Set(); });
+//      timers.Cancel(id);
+// - Hierarchical timing wheel: Levels wheels of Slots lists, each level's slot
+//   spanning Slots times the one below, so scheduling and cancelling are O(1)
+//   and far timers are only touched when they cascade down a level
+// - Deadlines are rounded up to whole ticks, callbacks never run early
+// - The thread only wakes for ticks with due timers (or to cascade), and sleeps
+//   without a timeout when nothing is scheduled
+// - Callbacks run on the timer thread without the wheel locked, so they may
+//   schedule and cancel timers, but should be short (e.g. wake someone)
+class TimerWheel {
+public:
+    typedef uint64_t TimerId; // 0 is never a valid id
+    typedef std::function<void()> Callback;
+
+    static const int SlotBits = 6;
+    static const int Slots = 1 << SlotBits;
+    static const int Levels = 4; // 2^24 ticks (~4.6 hours at 1 ms) before timers go round again
+
+    TimerWheel(std::chrono::nanoseconds tick = std::chrono::milliseconds(1));
+
+    // Stops the timer thread, pending callbacks are dropped
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Run callback on the timer thread once deadline has passed
+    TimerId At(MonotonicClock::time_point deadline, Callback callback);
+
+    template<class Rep, class Period>
+    TimerId After(std::chrono::duration<Rep, Period> delay, Callback callback) {
+        return At(MonotonicClock::now() + delay, std::move(callback));
+    }
+
+    // Returns true if the timer was removed before its callback started
+    bool Cancel(TimerId id);
+
+    // Number of scheduled timers whose callbacks have not started
+    size_t Pending();
+
+    inline std::chrono::nanoseconds Tick() const { return m_tick; }
+
+private:
+    struct Timer {
+        uint64_t expires = 0; // Tick
+        uint32_t index = 0; // In m_timers
+        uint32_t generation = 0; // Bumped on every reuse, so stale ids miss
+        bool armed = false;
+        Callback callback;
+        Timer* prev = nullptr;
+        Timer* next = nullptr;
+        Timer** slot = nullptr; // Head of the list holding it
+    };
+
+    const std::chrono::nanoseconds m_tick;
+    const MonotonicClock::time_point m_start;
+
+    Mutex m_lock{"TimerWheel::m_lock"};
+    Condition m_wake{"TimerWheel::m_wake"};
+
+    Timer* m_wheel[Levels][Slots] = {};
+    std::deque<Timer> m_timers; // Stable addresses, indexed by id
+    std::vector<uint32_t> m_free;
+    size_t m_pending = 0;
+
+    uint64_t m_current = 0; // Next tick to process
+    uint64_t m_wakeAt = 0; // Tick the timer thread sleeps until (0 while awake)
+    bool m_stopping = false;
+
+    std::unique_ptr<Thread<void>> m_thread;
+
+    uint64_t tickOf(MonotonicClock::time_point time, bool roundUp);
+    MonotonicClock::time_point timeOf(uint64_t tick);
+
+    void insert(Timer* timer);
+    void unlink(Timer* timer);
+
+    // Move the timers of a higher level slot down to where they now belong
+    void cascade(int level, int index);
+
+    // Tick to wake up for: the next due level 0 slot, or the next cascade
+    uint64_t nextWake();
+
+    void run();
+};
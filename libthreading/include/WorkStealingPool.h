@@ -0,0 +1,394 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    WorkStealingPool.h
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <sched.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Condition.h"
+#include "Core.h"
+#include "Mutex.h"
+#include "Thread.h"
+
+// Chase-Lev work-stealing deque of T pointers
+// - Only the owning thread may Push() and Pop() (at the bottom)
+// - Any thread may Steal() (from the top)
+template<typename T>
+class WorkDeque {
+public:
+    WorkDeque(int64_t capacity = 256) {
+        assert(capacity > 0 && !(capacity & (capacity-1))); // Power of two
+        m_arrays.emplace_back(new Array(capacity));
+        m_array.store(m_arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkDeque(const WorkDeque&) = delete;
+    WorkDeque& operator=(const WorkDeque&) = delete;
+
+    void Push(T* item) {
+        int64_t b = m_bottom.load(std::memory_order_relaxed);
+        int64_t t = m_top.load(std::memory_order_acquire);
+        Array* a = m_array.load(std::memory_order_relaxed);
+
+        if (b - t > a->capacity - 1) a = grow(a, t, b);
+
+        a->Put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Take the most recently pushed item, or nullptr if empty
+    T* Pop() {
+        int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+
+        T* item = nullptr;
+        if (t <= b) {
+            item = a->Get(b);
+            if (t == b) {
+                // Last item, race against thieves for it
+                if (!m_top.compare_exchange_strong(t, t + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed))
+                    item = nullptr;
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Take the oldest item, or nullptr if empty (or lost a race with another thread)
+    T* Steal() {
+        int64_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = m_bottom.load(std::memory_order_acquire);
+
+        if (t < b) {
+            Array* a = m_array.load(std::memory_order_acquire);
+            T* item = a->Get(t);
+            if (m_top.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed))
+                return item;
+        }
+        return nullptr;
+    }
+
+    bool Empty() {
+        int64_t b = m_bottom.load(std::memory_order_relaxed);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+        return b <= t;
+    }
+
+private:
+    struct Array {
+        int64_t capacity;
+        std::unique_ptr<std::atomic<T*>[]> slots;
+
+        Array(int64_t capacity)
+            : capacity(capacity), slots(new std::atomic<T*>[capacity]) {}
+
+        T* Get(int64_t i) { return slots[i & (capacity-1)].load(std::memory_order_acquire); }
+        void Put(int64_t i, T* item) { slots[i & (capacity-1)].store(item, std::memory_order_release); }
+    };
+
+    std::atomic<int64_t> m_top{0};
+    std::atomic<int64_t> m_bottom{0};
+    std::atomic<Array*> m_array;
+
+    // Thieves may still read an old array, so outgrown arrays are kept until destruction
+    std::vector<std::unique_ptr<Array>> m_arrays;
+
+    Array* grow(Array* old, int64_t t, int64_t b) {
+        m_arrays.emplace_back(new Array(old->capacity * 2));
+        Array* a = m_arrays.back().get();
+        for (int64_t i = t; i < b; ++i)
+            a->Put(i, old->Get(i));
+        m_array.store(a, std::memory_order_release);
+        return a;
+    }
+};
+
+class WorkStealingPool;
+
+// Handle to a task submitted to a WorkStealingPool
+// - Ret is the return type of the submitted task
+template<typename Ret>
+class StealTask {
+public:
+    StealTask(WorkStealingPool* pool) : m_pool(pool) {}
+
+    // Get return value from task (waits for task if not finished)
+    // - When called from a pool worker, other tasks are run while waiting,
+    //   so tasks may safely wait on the tasks they spawn
+    auto Wait() -> decltype(std::declval<TaskResult<Ret>&>().Get());
+
+    // Is the task finished with execution?
+    bool Done() { return m_finished.load(std::memory_order_acquire); }
+
+private:
+    friend WorkStealingPool;
+
+    WorkStealingPool* m_pool;
+    std::atomic<bool> m_finished{false};
+    std::atomic<int> m_sleepers{0};
+    Mutex m_lock{"StealTask::m_lock"}; // Only used to park non-worker waiters
+    Condition m_done{"StealTask::m_done"};
+    TaskResult<Ret> m_result;
+
+    template<typename Task>
+    void run(Task& task) {
+        m_result.Run(task);
+        m_finished.store(true, std::memory_order_seq_cst);
+
+        if (m_sleepers.load(std::memory_order_seq_cst)) {
+            ScopedMutex guard(m_lock);
+            m_done.Broadcast();
+        }
+    }
+};
+
+// Runs submitted tasks on a fixed set of workers, each with its own WorkDeque.
+// Tasks submitted from a worker go to that worker's deque; idle workers steal
+// from a random victim, so recursive and unbalanced work spreads without a global lock.
+class WorkStealingPool {
+public:
+    // Start num_threads workers, optionally pinning worker i to
+    // available CPU (i % Core::Count()) (requires Core::Init())
+    WorkStealingPool(int num_threads, bool pinned = false) {
+        assert(num_threads > 0);
+
+        // All deques must exist before any worker starts stealing
+        for (int i = 0; i < num_threads; ++i)
+            m_workers.emplace_back(new Worker(this, i));
+
+        for (int i = 0; i < num_threads; ++i) {
+            int cpu = pinned ? (int)(i % Core::Count()) : -1;
+            m_workers[i]->thread = Core::MakeThread<void,Worker*>(cpu, worker_task, m_workers[i].get());
+        }
+    }
+
+    // Start num_threads workers, pinning worker i where policy places it (see Core::Place)
+    WorkStealingPool(int num_threads, Placement policy) {
+        assert(num_threads > 0);
+
+        for (int i = 0; i < num_threads; ++i)
+            m_workers.emplace_back(new Worker(this, i));
+
+        for (int i = 0; i < num_threads; ++i)
+            m_workers[i]->thread = Core::MakeThread<void,Worker*>(policy, i, worker_task, m_workers[i].get());
+    }
+
+    // Finishes all queued tasks, then joins the workers
+    ~WorkStealingPool() {
+        {
+            ScopedMutex guard(m_lock);
+            m_stopping.store(true);
+            m_wake.Broadcast();
+        }
+        for (auto& worker : m_workers)
+            worker->thread->Join();
+
+        // Clean up any tasks that were stranded
+        for (Job* job : m_injected)
+            delete job;
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    inline int Size() { return (int)m_workers.size(); }
+
+    // Queue a callable taking no arguments, returns a handle to its result
+    template<typename Task>
+    auto Submit(Task&& task) -> std::shared_ptr<StealTask<decltype(task())>> {
+        using Ret = decltype(task());
+        auto handle = std::make_shared<StealTask<Ret>>(this);
+        push(new BoundJob<typename std::decay<Task>::type, Ret>(std::forward<Task>(task), handle));
+        return handle;
+    }
+
+    // Run one queued task on the calling thread, returns false if none was found
+    // - Only pool workers may help, other threads always return false
+    bool RunOne() {
+        Worker* self = local();
+        if (!self) return false;
+
+        Job* job = find(self);
+        if (!job) return false;
+
+        execute(job);
+        return true;
+    }
+
+    // Is the calling thread one of this pool's workers?
+    inline bool IsWorker() { return local() != nullptr; }
+
+private:
+    // Type-erased submitted task
+    struct Job {
+        virtual ~Job() {}
+        virtual void Run() = 0;
+    };
+
+    template<typename Task, typename Ret>
+    struct BoundJob : Job {
+        Task task;
+        std::shared_ptr<StealTask<Ret>> handle;
+
+        template<typename T>
+        BoundJob(T&& task, std::shared_ptr<StealTask<Ret>> handle)
+            : task(std::forward<T>(task)), handle(std::move(handle)) {}
+
+        void Run() override { handle->run(task); }
+    };
+
+    struct Worker {
+        WorkStealingPool* pool;
+        int index;
+        uint32_t seed; // For picking random victims
+        WorkDeque<Job> deque;
+        std::shared_ptr<Thread<void,Worker*>> thread;
+
+        Worker(WorkStealingPool* pool, int index)
+            : pool(pool), index(index), seed(2654435761u * (index + 1)) {}
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    // Jobs submitted from outside the pool (the only locked path)
+    Mutex m_lock{"WorkStealingPool::m_lock"};
+    Condition m_wake{"WorkStealingPool::m_wake"};
+    std::deque<Job*> m_injected;
+
+    std::atomic<long> m_queued{0}; // Jobs pushed but not yet taken
+    std::atomic<int> m_sleepers{0};
+    std::atomic<bool> m_stopping{false};
+
+    // The worker running on the calling thread (if any)
+    static thread_local Worker* m_local;
+
+    Worker* local() { return (m_local && m_local->pool == this) ? m_local : nullptr; }
+
+    void push(Job* job) {
+        // Count the job before it is visible, so sleepers can never miss it
+        m_queued.fetch_add(1, std::memory_order_seq_cst);
+
+        Worker* self = local();
+        if (self) {
+            self->deque.Push(job);
+        } else {
+            ScopedMutex guard(m_lock);
+            m_injected.push_back(job);
+        }
+
+        if (m_sleepers.load(std::memory_order_seq_cst)) {
+            ScopedMutex guard(m_lock);
+            m_wake.Signal();
+        }
+    }
+
+    Job* find(Worker* self) {
+        Job* job = self->deque.Pop();
+        if (!job) job = steal(self);
+        if (!job && m_queued.load(std::memory_order_relaxed)) {
+            ScopedMutex guard(m_lock);
+            if (!m_injected.empty()) {
+                job = m_injected.front();
+                m_injected.pop_front();
+            }
+        }
+
+        if (job) m_queued.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    // Try each other worker once, starting from a random victim
+    Job* steal(Worker* self) {
+        int n = Size();
+        if (n < 2) return nullptr;
+
+        self->seed ^= self->seed << 13;
+        self->seed ^= self->seed >> 17;
+        self->seed ^= self->seed << 5;
+
+        int start = self->seed % n;
+        for (int i = 0; i < n; ++i) {
+            int victim = (start + i) % n;
+            if (victim == self->index) continue;
+            Job* job = m_workers[victim]->deque.Steal();
+            if (job) return job;
+        }
+        return nullptr;
+    }
+
+    void execute(Job* job) {
+        job->Run();
+        delete job;
+    }
+
+    // Blocks until there might be work, returns false once stopping with nothing queued
+    bool idle() {
+        // Spin a little first, work tends to arrive in bursts
+        for (int i = 0; i < 64; ++i) {
+            if (m_queued.load(std::memory_order_relaxed)) return true;
+            sched_yield();
+        }
+
+        ScopedMutex guard(m_lock);
+        m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+        while (!m_queued.load(std::memory_order_seq_cst) && !m_stopping.load())
+            m_wake.Wait(m_lock);
+        m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+
+        return m_queued.load() || !m_stopping.load();
+    }
+
+    // Define the worker function:
+    // --  void* worker_task(Worker** arg)
+    static THREAD_FUNC(worker_task, void,Worker*) {
+        Worker* self = *arg;
+        m_local = self;
+
+        for (;;) {
+            Job* job = self->pool->find(self);
+            if (job) self->pool->execute(job);
+            else if (!self->pool->idle()) break;
+        }
+
+        m_local = nullptr;
+        THREAD_RETURN(nullptr);
+    }
+};
+
+template<typename Ret>
+auto StealTask<Ret>::Wait() -> decltype(std::declval<TaskResult<Ret>&>().Get()) {
+    if (!Done()) {
+        if (m_pool->IsWorker()) {
+            // Keep this worker busy rather than blocking it
+            while (!Done())
+                if (!m_pool->RunOne()) sched_yield();
+        } else {
+            ScopedMutex guard(m_lock);
+            m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+            while (!m_finished.load(std::memory_order_seq_cst))
+                m_done.Wait(m_lock);
+            m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    return m_result.Get();
+}
@@ -6,6 +6,214 @@
 ==============================================================================*/
 #include "Core.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+
 // Allocate static class variables
 unsigned int Core::m_numProc = 0;
 std::vector<int> Core::m_avail;
+std::vector<int> Core::m_index;
+std::vector<CpuInfo> Core::m_info;
+std::vector<int> Core::m_compact;
+std::vector<int> Core::m_scatter;
+std::vector<int> Core::m_physical;
+int Core::m_numNodes = 1;
+int Core::m_numPackages = 1;
+int Core::m_numCores = 1;
+
+#define SYSFS_CPU "/sys/devices/system/cpu/"
+#define SYSFS_NODE "/sys/devices/system/node/"
+
+// Read the first line of a sysfs file, returns false if it cannot be read
+static bool readLine(const std::string& path, std::string& line) {
+    std::ifstream file(path);
+    return file && std::getline(file, line);
+}
+
+static int readInt(const std::string& path, int fallback) {
+    std::string line;
+    if (!readLine(path, line)) return fallback;
+    try { return std::stoi(line); }
+    catch (...) { return fallback; }
+}
+
+// Parse a sysfs cpu list such as "0-3,8,10-11"
+static std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        int first, last;
+        int n = sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (n <= 0) continue;
+        if (n == 1) last = first;
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// Lowest CPU id sharing the given cache level with cpu (-1 if unknown)
+static int cacheDomain(int cpu, int level) {
+    std::string base = SYSFS_CPU "cpu" + std::to_string(cpu) + "/cache/index";
+    for (int i = 0; ; ++i) {
+        std::string dir = base + std::to_string(i) + "/";
+        int l = readInt(dir + "level", -1);
+        if (l < 0) return -1; // No more caches
+        if (l != level) continue;
+
+        std::string type, shared;
+        readLine(dir + "type", type);
+        if (type == "Instruction") continue;
+        if (!readLine(dir + "shared_cpu_list", shared)) return -1;
+
+        std::vector<int> cpus = parseCpuList(shared);
+        return cpus.empty() ? cpu : *std::min_element(cpus.begin(), cpus.end());
+    }
+}
+
+void Core::readTopology() {
+    int count = m_avail.size();
+    m_info.assign(count, CpuInfo());
+
+    // Per-CPU ids, falling back to a flat machine where sysfs is missing
+    std::map<std::pair<int,int>, int> cores; // (package, core_id) -> unique core
+    for (int i = 0; i < count; ++i) {
+        int cpu = m_avail[i];
+        std::string dir = SYSFS_CPU "cpu" + std::to_string(cpu) + "/topology/";
+
+        CpuInfo& info = m_info[i];
+        info.cpu = cpu;
+        info.package = std::max(readInt(dir + "physical_package_id", 0), 0);
+        info.node = 0;
+
+        int coreId = readInt(dir + "core_id", cpu);
+        auto found = cores.insert(std::make_pair(std::make_pair(info.package, coreId), (int)cores.size()));
+        info.core = found.first->second;
+
+        int l2 = cacheDomain(cpu, 2);
+        int l3 = cacheDomain(cpu, 3);
+        info.l2 = (l2 >= 0) ? l2 : cpu;
+        info.l3 = (l3 >= 0) ? l3 : info.package;
+
+        // Rank among SMT siblings, by CPU id
+        std::string siblings;
+        info.smt = 0;
+        if (readLine(dir + "thread_siblings_list", siblings))
+            for (int sibling : parseCpuList(siblings))
+                if (sibling < cpu) ++info.smt;
+    }
+
+    // NUMA nodes, from each node's cpu list
+    std::set<int> nodes;
+    if (DIR* dir = opendir(SYSFS_NODE)) {
+        while (dirent* entry = readdir(dir)) {
+            int node;
+            if (sscanf(entry->d_name, "node%d", &node) != 1) continue;
+
+            std::string list;
+            if (!readLine(SYSFS_NODE + std::string(entry->d_name) + "/cpulist", list)) continue;
+            nodes.insert(node);
+            for (int cpu : parseCpuList(list))
+                if (cpu < (int)m_index.size() && m_index[cpu] >= 0)
+                    m_info[m_index[cpu]].node = node;
+        }
+        closedir(dir);
+    }
+
+    std::set<int> packages;
+    for (auto& info : m_info) packages.insert(info.package);
+
+    m_numNodes = std::max((int)nodes.size(), 1);
+    m_numPackages = std::max((int)packages.size(), 1);
+    m_numCores = std::max((int)cores.size(), 1);
+
+    // Placement orders over available indices
+    std::vector<int> order(count);
+    for (int i = 0; i < count; ++i) order[i] = i;
+
+    // Compact: neighbours in the order share as much hardware as possible
+    m_compact = order;
+    std::stable_sort(m_compact.begin(), m_compact.end(), [](int a, int b) {
+        const CpuInfo &x = m_info[a], &y = m_info[b];
+        return std::tie(x.node, x.package, x.l3, x.l2, x.core, x.smt)
+             < std::tie(y.node, y.package, y.l3, y.l2, y.core, y.smt);
+    });
+
+    // Scatter: deal the compact order out one package (then L3, then core) at a time
+    std::map<int,int> rankInPackage; // Core rank within its package, in compact order
+    std::map<int,int> seenInPackage;
+    for (int i : m_compact) {
+        const CpuInfo& info = m_info[i];
+        if (info.smt == 0 && !rankInPackage.count(info.core))
+            rankInPackage[info.core] = seenInPackage[info.package]++;
+    }
+    m_scatter = order;
+    std::stable_sort(m_scatter.begin(), m_scatter.end(), [&rankInPackage](int a, int b) {
+        const CpuInfo &x = m_info[a], &y = m_info[b];
+        int rx = rankInPackage.count(x.core) ? rankInPackage[x.core] : 0;
+        int ry = rankInPackage.count(y.core) ? rankInPackage[y.core] : 0;
+        return std::tie(x.smt, rx, x.package) < std::tie(y.smt, ry, y.package);
+    });
+
+    // Physical cores: first available CPU of each core, in compact order
+    m_physical.clear();
+    std::set<int> used;
+    for (int i : m_compact)
+        if (used.insert(m_info[i].core).second) m_physical.push_back(i);
+}
+
+std::vector<int> Core::Siblings(int index) {
+    std::vector<int> siblings;
+    for (int i = 0; i < (int)Count(); ++i)
+        if (m_info[i].core == m_info[index].core) siblings.push_back(i);
+    return siblings;
+}
+
+std::vector<int> Core::SharingL3(int index) {
+    std::vector<int> sharing;
+    for (int i = 0; i < (int)Count(); ++i)
+        if (m_info[i].package == m_info[index].package && m_info[i].l3 == m_info[index].l3)
+            sharing.push_back(i);
+    return sharing;
+}
+
+std::vector<int> Core::OnNode(int node) {
+    std::vector<int> cpus;
+    for (int i = 0; i < (int)Count(); ++i)
+        if (m_info[i].node == node) cpus.push_back(i);
+    return cpus;
+}
+
+int Core::Place(Placement policy, int n, int anchor) {
+    assert(Count() && n >= 0);
+
+    switch (policy) {
+    case Placement::Compact: return m_compact[n % m_compact.size()];
+    case Placement::Scatter: return m_scatter[n % m_scatter.size()];
+    case Placement::PhysicalCores: return m_physical[n % m_physical.size()];
+    case Placement::SameL3: {
+        if (anchor < 0) anchor = Current();
+
+        // Physical cores of the anchor's L3 first (in compact order), then their siblings
+        const CpuInfo& at = m_info[anchor];
+        std::vector<int> candidates;
+        for (int smt = 0; candidates.size() < Count(); ++smt) {
+            size_t before = candidates.size();
+            for (int i : m_compact)
+                if (m_info[i].smt == smt && m_info[i].package == at.package && m_info[i].l3 == at.l3)
+                    candidates.push_back(i);
+            if (candidates.size() == before && smt > 0) break;
+        }
+        if (candidates.empty()) return anchor;
+        return candidates[n % candidates.size()];
+    }
+    }
+    return n % Count();
+}
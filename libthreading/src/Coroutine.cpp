@@ -0,0 +1,14 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Coroutine.cpp
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#include "Coroutine.h"
+
+#ifdef LIBTHREADING_COROUTINES
+
+// Allocate static class variables
+thread_local Executor::Worker* Executor::m_local = nullptr;
+
+#endif
@@ -0,0 +1,139 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Epoch.cpp
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#include "Epoch.h"
+
+#include <cstdlib>
+#include <new>
+#include <sched.h>
+
+#include "Core.h"
+
+// Allocate static class variables
+std::atomic<uint64_t> Epoch::m_global{1};
+std::atomic<Epoch::Record*> Epoch::m_records{nullptr};
+thread_local Epoch::Record* Epoch::m_record = nullptr;
+Mutex Epoch::m_orphanLock;
+std::vector<Epoch::Retired> Epoch::m_orphans;
+
+// Unregisters threads when they exit
+namespace {
+    struct Owner {
+        ~Owner() { Epoch::Unregister(); }
+    };
+}
+
+void Epoch::Register() {
+    if (m_record) return;
+
+    static thread_local Owner owner;
+    (void)owner;
+
+    // Reuse the record of a thread that has exited
+    for (Record* record = m_records.load(std::memory_order_acquire); record; record = record->next) {
+        bool inUse = false;
+        if (!record->inUse.load(std::memory_order_relaxed) &&
+                record->inUse.compare_exchange_strong(inUse, true, std::memory_order_acquire)) {
+            m_record = record;
+            return;
+        }
+    }
+
+    // Whole cache lines, so announcing an epoch never invalidates another thread's record
+    size_t lines = (sizeof(Record) + Core::CacheLine - 1) / Core::CacheLine;
+    void* memory = nullptr;
+    if (posix_memalign(&memory, Core::CacheLine, lines*Core::CacheLine)) throw std::bad_alloc();
+    Record* record = new (memory) Record();
+
+    Record* head = m_records.load(std::memory_order_relaxed);
+    do {
+        record->next = head;
+    } while (!m_records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+
+    m_record = record;
+}
+
+void Epoch::Unregister() {
+    Record* record = m_record;
+    if (!record) return;
+    assert(record->nesting == 0);
+
+    if (!record->limbo.empty()) {
+        ScopedMutex lock(m_orphanLock);
+        m_orphans.insert(m_orphans.end(), record->limbo.begin(), record->limbo.end());
+        record->limbo.clear();
+    }
+
+    record->sinceReclaim = 0;
+    record->inUse.store(false, std::memory_order_release);
+    m_record = nullptr;
+}
+
+void Epoch::Retire(void* ptr, Deleter deleter) {
+    if (!m_record) Register();
+    Record* record = m_record;
+
+    // Unlinking happened before this load, so readers of a later epoch cannot see ptr
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    record->limbo.push_back({ptr, deleter, m_global.load(std::memory_order_relaxed)});
+
+    if (++record->sinceReclaim >= ReclaimThreshold) {
+        record->sinceReclaim = 0;
+        tryAdvance();
+        reclaim(record->limbo);
+        reclaimOrphans();
+    }
+}
+
+void Epoch::Synchronize() {
+    if (!m_record) Register();
+    Record* record = m_record;
+    assert(record->nesting == 0);
+
+    // Two advances past now, so everything retired so far is safe
+    uint64_t target = m_global.load(std::memory_order_acquire) + 2;
+    while (m_global.load(std::memory_order_acquire) < target)
+        if (!tryAdvance()) sched_yield();
+
+    reclaim(record->limbo);
+    record->sinceReclaim = 0;
+
+    ScopedMutex lock(m_orphanLock);
+    reclaim(m_orphans);
+}
+
+// Move to the next epoch if every active reader has seen the current one
+bool Epoch::tryAdvance() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t epoch = m_global.load(std::memory_order_relaxed);
+
+    for (Record* record = m_records.load(std::memory_order_acquire); record; record = record->next) {
+        uint64_t announced = record->epoch.load(std::memory_order_acquire);
+        if ((announced & ACTIVE) && (announced >> 1) != epoch) return false;
+    }
+
+    // Failing means another thread advanced it already
+    m_global.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+    return true;
+}
+
+// Free the retirements at least two epochs old, keeping the rest in order
+void Epoch::reclaim(std::vector<Retired>& limbo) {
+    uint64_t epoch = m_global.load(std::memory_order_acquire);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < limbo.size(); ++i) {
+        if (limbo[i].epoch + 2 <= epoch) limbo[i].deleter(limbo[i].ptr);
+        else limbo[kept++] = limbo[i];
+    }
+    limbo.resize(kept);
+}
+
+void Epoch::reclaimOrphans() {
+    if (!m_orphanLock.Try()) return; // Someone else is on it
+    if (!m_orphans.empty()) reclaim(m_orphans);
+    m_orphanLock.Unlock();
+}
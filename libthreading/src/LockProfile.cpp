@@ -0,0 +1,211 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    LockProfile.cpp
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#include "LockProfile.h"
+
+#ifdef LIBTHREADING_LOCK_PROFILING
+
+#include <algorithm>
+#include <iomanip>
+#include <pthread.h>
+#include <sstream>
+
+// A plain pthread mutex, the registry must not profile itself
+static pthread_mutex_t s_registryLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Function statics, so locks constructed during static initialization can register
+static std::vector<LockProfile*>& liveProfiles() {
+    static std::vector<LockProfile*> profiles;
+    return profiles;
+}
+
+static std::vector<LockRegistry::Entry>& retiredEntries() {
+    static std::vector<LockRegistry::Entry> entries;
+    return entries;
+}
+
+LockProfile::LockProfile(const char* kind)
+    : m_kind(kind)
+{
+    for (int i = 0; i < Buckets; ++i) {
+        m_wait[i].store(0, std::memory_order_relaxed);
+        m_hold[i].store(0, std::memory_order_relaxed);
+    }
+    LockRegistry::add(this);
+}
+
+LockProfile::~LockProfile() { LockRegistry::remove(this); }
+
+void LockProfile::SetName(const char* name) {
+    pthread_mutex_lock(&s_registryLock);
+    m_name = name ? name : "";
+    pthread_mutex_unlock(&s_registryLock);
+}
+
+static LockRegistry::Entry snapshot(const LockProfile& profile, const char* kind, const std::string& name) {
+    LockRegistry::Entry entry;
+    entry.kind = kind;
+    if (!name.empty()) {
+        entry.name = name;
+    } else {
+        std::ostringstream unnamed;
+        unnamed << kind << "@" << (const void*)&profile;
+        entry.name = unnamed.str();
+    }
+    return entry;
+}
+
+// Fold a profile's counters into entry
+static void accumulate(LockRegistry::Entry& entry, const LockRegistry::Entry& other) {
+    entry.acquisitions += other.acquisitions;
+    entry.contended += other.contended;
+    entry.waitNs += other.waitNs;
+    entry.holdNs += other.holdNs;
+    for (int i = 0; i < LockProfile::Buckets; ++i) {
+        entry.wait[i] += other.wait[i];
+        entry.hold[i] += other.hold[i];
+    }
+}
+
+void LockRegistry::add(LockProfile* profile) {
+    pthread_mutex_lock(&s_registryLock);
+    liveProfiles().push_back(profile);
+    pthread_mutex_unlock(&s_registryLock);
+}
+
+// Add entry to entries, merged with any entry of the same kind and name
+static void merge(std::vector<LockRegistry::Entry>& entries, const LockRegistry::Entry& entry) {
+    auto same = std::find_if(entries.begin(), entries.end(), [&entry](const LockRegistry::Entry& other) {
+        return other.kind == entry.kind && other.name == entry.name;
+    });
+    if (same != entries.end()) accumulate(*same, entry);
+    else entries.push_back(entry);
+}
+
+void LockRegistry::remove(LockProfile* profile) {
+    pthread_mutex_lock(&s_registryLock);
+
+    std::vector<LockProfile*>& live = liveProfiles();
+    live.erase(std::remove(live.begin(), live.end(), profile), live.end());
+
+    // Keep the statistics of used locks, unnamed ones merged per kind
+    if (profile->m_acquisitions.load(std::memory_order_relaxed)) {
+        Entry entry = read(*profile);
+        if (profile->m_name.empty()) entry.name = entry.kind + " (destroyed, unnamed)";
+        merge(retiredEntries(), entry);
+    }
+
+    pthread_mutex_unlock(&s_registryLock);
+}
+
+LockRegistry::Entry LockRegistry::read(const LockProfile& profile) {
+    Entry entry = snapshot(profile, profile.m_kind, profile.m_name);
+    entry.acquisitions = profile.m_acquisitions.load(std::memory_order_relaxed);
+    entry.contended = profile.m_contended.load(std::memory_order_relaxed);
+    entry.waitNs = profile.m_waitNs.load(std::memory_order_relaxed);
+    entry.holdNs = profile.m_holdNs.load(std::memory_order_relaxed);
+    for (int i = 0; i < LockProfile::Buckets; ++i) {
+        entry.wait[i] = profile.m_wait[i].load(std::memory_order_relaxed);
+        entry.hold[i] = profile.m_hold[i].load(std::memory_order_relaxed);
+    }
+    return entry;
+}
+
+std::vector<LockRegistry::Entry> LockRegistry::Collect() {
+    std::vector<Entry> entries;
+
+    pthread_mutex_lock(&s_registryLock);
+    for (LockProfile* profile : liveProfiles())
+        if (profile->m_acquisitions.load(std::memory_order_relaxed))
+            merge(entries, read(*profile));
+    for (const Entry& entry : retiredEntries())
+        merge(entries, entry);
+    pthread_mutex_unlock(&s_registryLock);
+
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.waitNs > b.waitNs;
+    });
+    return entries;
+}
+
+// Upper bound of a histogram bucket, in ns
+static uint64_t bucketLimit(int bucket) { return bucket ? (1ULL << bucket) : 1; }
+
+// Smallest bucket limit covering fraction of the samples
+static uint64_t percentile(const uint64_t* histogram, double fraction) {
+    uint64_t total = 0;
+    for (int i = 0; i < LockProfile::Buckets; ++i) total += histogram[i];
+    if (!total) return 0;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LockProfile::Buckets; ++i) {
+        seen += histogram[i];
+        if (seen >= fraction*total) return bucketLimit(i);
+    }
+    return bucketLimit(LockProfile::Buckets - 1);
+}
+
+void LockRegistry::Report(std::ostream& out, int top) {
+    std::vector<Entry> entries = Collect();
+
+    out << "Lock contention (top " << std::min<size_t>(top, entries.size()) << " of " << entries.size() << " by total wait):\n";
+    out << std::left << std::setw(32) << "name" << std::right
+        << std::setw(12) << "acquired" << std::setw(12) << "contended"
+        << std::setw(12) << "wait ms" << std::setw(14) << "p99 wait us"
+        << std::setw(12) << "hold ms" << std::setw(14) << "p99 hold us" << "\n";
+
+    out << std::fixed << std::setprecision(3);
+    for (int i = 0; i < top && i < (int)entries.size(); ++i) {
+        const Entry& entry = entries[i];
+        out << std::left << std::setw(32) << entry.name << std::right
+            << std::setw(12) << entry.acquisitions << std::setw(12) << entry.contended
+            << std::setw(12) << entry.waitNs/1e6 << std::setw(14) << percentile(entry.wait, 0.99)/1e3
+            << std::setw(12) << entry.holdNs/1e6 << std::setw(14) << percentile(entry.hold, 0.99)/1e3 << "\n";
+    }
+    out << std::defaultfloat;
+}
+
+static void jsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if ((unsigned char)c < 0x20) out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+        else out << c;
+    }
+    out << '"';
+}
+
+static void jsonHistogram(std::ostream& out, const uint64_t* histogram) {
+    out << "[";
+    for (int i = 0; i < LockProfile::Buckets; ++i)
+        out << (i ? "," : "") << histogram[i];
+    out << "]";
+}
+
+void LockRegistry::Json(std::ostream& out) {
+    std::vector<Entry> entries = Collect();
+
+    out << "[";
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry& entry = entries[i];
+        out << (i ? ",\n " : "\n ") << "{\"kind\":";
+        jsonString(out, entry.kind);
+        out << ",\"name\":";
+        jsonString(out, entry.name);
+        out << ",\"acquisitions\":" << entry.acquisitions
+            << ",\"contended\":" << entry.contended
+            << ",\"wait_ns\":" << entry.waitNs
+            << ",\"hold_ns\":" << entry.holdNs
+            << ",\"wait_log2_ns\":";
+        jsonHistogram(out, entry.wait);
+        out << ",\"hold_log2_ns\":";
+        jsonHistogram(out, entry.hold);
+        out << "}";
+    }
+    out << "\n]\n";
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    Thread.cpp
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#include "Thread.h"
+
+#include <sys/mman.h>
+
+// Allocate static class variables
+Mutex StackCache::m_lock("StackCache::m_lock");
+std::vector<StackCache::Stack> StackCache::m_idle;
+size_t StackCache::m_idleBytes = 0;
+size_t StackCache::m_limit = 64 << 20;
+
+static size_t pageRound(size_t bytes) {
+    static const size_t page = sysconf(_SC_PAGESIZE);
+    return (bytes + page - 1) / page * page;
+}
+
+StackCache::Stack StackCache::Acquire(size_t size, size_t guard, bool prefault) {
+    Stack stack;
+    stack.size = pageRound(size);
+    stack.guard = pageRound(guard);
+
+    {
+        ScopedMutex guardLock(m_lock);
+        // Most recently released first, its pages are the likeliest to still be cached
+        for (size_t i = m_idle.size(); i-- > 0;) {
+            if (m_idle[i].size == stack.size && m_idle[i].guard == stack.guard) {
+                stack = m_idle[i];
+                m_idle.erase(m_idle.begin() + i);
+                m_idleBytes -= stack.size + stack.guard;
+                break;
+            }
+        }
+    }
+
+    if (!stack.base) {
+        // Reserve the guard with the stack, then take away its access
+        void* base = mmap(nullptr, stack.size + stack.guard, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | (prefault ? MAP_POPULATE : 0), -1, 0);
+        assert(base != MAP_FAILED);
+        if (stack.guard) mprotect(base, stack.guard, PROT_NONE);
+        stack.base = base;
+    } else if (prefault) {
+        // A reused stack may have only been touched near its top
+        static const size_t page = sysconf(_SC_PAGESIZE);
+        volatile char* usable = (volatile char*)Usable(stack);
+        for (size_t offset = 0; offset < stack.size; offset += page)
+            usable[offset] = 0;
+    }
+
+    return stack;
+}
+
+void StackCache::Release(const Stack& stack) {
+    {
+        ScopedMutex guard(m_lock);
+        if (m_idleBytes + stack.size + stack.guard <= m_limit) {
+            m_idle.push_back(stack);
+            m_idleBytes += stack.size + stack.guard;
+            return;
+        }
+    }
+    unmap(stack);
+}
+
+void StackCache::SetLimit(size_t bytes) {
+    std::vector<Stack> excess;
+    {
+        ScopedMutex guard(m_lock);
+        m_limit = bytes;
+        // Drop the oldest stacks first
+        while (m_idleBytes > m_limit) {
+            excess.push_back(m_idle.front());
+            m_idleBytes -= m_idle.front().size + m_idle.front().guard;
+            m_idle.erase(m_idle.begin());
+        }
+    }
+    for (const Stack& stack : excess) unmap(stack);
+}
+
+size_t StackCache::Limit() {
+    ScopedMutex guard(m_lock);
+    return m_limit;
+}
+
+void StackCache::Trim() {
+    std::vector<Stack> idle;
+    {
+        ScopedMutex guard(m_lock);
+        idle.swap(m_idle);
+        m_idleBytes = 0;
+    }
+    for (const Stack& stack : idle) unmap(stack);
+}
+
+size_t StackCache::Cached() {
+    ScopedMutex guard(m_lock);
+    return m_idle.size();
+}
+
+void StackCache::unmap(const Stack& stack) {
+    munmap(stack.base, stack.size + stack.guard);
+}
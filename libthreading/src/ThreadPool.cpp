@@ -0,0 +1,10 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    ThreadPool.cpp
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#include "ThreadPool.h"
+
+// Allocate static class variables
+thread_local ThreadPool::WorkerArg* ThreadPool::m_current = nullptr;
@@ -0,0 +1,189 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    TimerWheel.cpp
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#include "TimerWheel.h"
+
+#include <cassert>
+
+TimerWheel::TimerWheel(std::chrono::nanoseconds tick)
+    : m_tick(tick), m_start(MonotonicClock::now())
+{
+    assert(tick.count() > 0);
+    m_thread.reset(new Thread<void>(ThreadAttr().Name("timer wheel"), [this]() { run(); }));
+}
+
+TimerWheel::~TimerWheel() {
+    {
+        ScopedMutex guard(m_lock);
+        m_stopping = true;
+        m_wake.Signal();
+    }
+    m_thread.reset(); // Joins
+}
+
+TimerWheel::TimerId TimerWheel::At(MonotonicClock::time_point deadline, Callback callback) {
+    ScopedMutex guard(m_lock);
+
+    // An empty wheel may have slept for long, catch it up rather than walk every tick
+    if (!m_pending) {
+        uint64_t now = tickOf(MonotonicClock::now(), false);
+        if (m_current < now) m_current = now;
+    }
+
+    uint32_t index;
+    if (!m_free.empty()) {
+        index = m_free.back();
+        m_free.pop_back();
+    } else {
+        index = m_timers.size();
+        m_timers.emplace_back();
+        m_timers.back().index = index;
+    }
+
+    Timer* timer = &m_timers[index];
+    timer->expires = tickOf(deadline, true);
+    timer->callback = std::move(callback);
+    timer->armed = true;
+    insert(timer);
+    ++m_pending;
+
+    // Only wake the thread if it would sleep past this timer
+    if (timer->expires < m_wakeAt) m_wake.Signal();
+
+    // Index + 1 so that no id is 0
+    return ((uint64_t)timer->generation << 32) | (index + 1);
+}
+
+bool TimerWheel::Cancel(TimerId id) {
+    uint32_t index = (uint32_t)id - 1;
+    uint32_t generation = id >> 32;
+
+    ScopedMutex guard(m_lock);
+    if (!id || index >= m_timers.size()) return false;
+
+    Timer* timer = &m_timers[index];
+    if (!timer->armed || timer->generation != generation) return false;
+
+    unlink(timer);
+    timer->armed = false;
+    timer->callback = nullptr;
+    ++timer->generation;
+    m_free.push_back(index);
+    --m_pending;
+    return true;
+}
+
+size_t TimerWheel::Pending() {
+    ScopedMutex guard(m_lock);
+    return m_pending;
+}
+
+uint64_t TimerWheel::tickOf(MonotonicClock::time_point time, bool roundUp) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_start).count();
+    if (ns < 0) ns = 0;
+    uint64_t tick = ns / m_tick.count();
+    if (roundUp && ns % m_tick.count()) ++tick;
+    return tick;
+}
+
+MonotonicClock::time_point TimerWheel::timeOf(uint64_t tick) {
+    return m_start + std::chrono::duration_cast<MonotonicClock::duration>(m_tick * tick);
+}
+
+void TimerWheel::insert(Timer* timer) {
+    // Already due timers go in the next processed slot
+    if (timer->expires < m_current) timer->expires = m_current;
+
+    uint64_t delta = timer->expires - m_current;
+    int level = 0;
+    while (level < Levels - 1 && delta >= (1ULL << (SlotBits*(level + 1)))) ++level;
+
+    // Beyond the top level's reach, park in its furthest slot and re-cascade from there
+    uint64_t expires = timer->expires;
+    uint64_t reach = 1ULL << (SlotBits*Levels);
+    if (delta >= reach) expires = m_current + reach - 1;
+
+    Timer** slot = &m_wheel[level][(expires >> (SlotBits*level)) & (Slots - 1)];
+    timer->slot = slot;
+    timer->prev = nullptr;
+    timer->next = *slot;
+    if (*slot) (*slot)->prev = timer;
+    *slot = timer;
+}
+
+void TimerWheel::unlink(Timer* timer) {
+    if (timer->prev) timer->prev->next = timer->next;
+    else *timer->slot = timer->next;
+    if (timer->next) timer->next->prev = timer->prev;
+    timer->prev = timer->next = nullptr;
+    timer->slot = nullptr;
+}
+
+void TimerWheel::cascade(int level, int index) {
+    Timer* timer = m_wheel[level][index];
+    m_wheel[level][index] = nullptr;
+    while (timer) {
+        Timer* next = timer->next;
+        insert(timer);
+        timer = next;
+    }
+}
+
+uint64_t TimerWheel::nextWake() {
+    if (!m_pending) return UINT64_MAX;
+
+    // Level 0 slots from m_current up to the next cascade point (m_current itself may be one)
+    uint64_t cascadeAt = (m_current + Slots - 1) & ~(uint64_t)(Slots - 1);
+    for (uint64_t tick = m_current; tick < cascadeAt; ++tick)
+        if (m_wheel[0][tick & (Slots - 1)]) return tick;
+    return cascadeAt;
+}
+
+void TimerWheel::run() {
+    std::vector<Callback> due;
+
+    ScopedMutex guard(m_lock);
+    while (!m_stopping) {
+        uint64_t now = tickOf(MonotonicClock::now(), false);
+
+        while (m_current <= now) {
+            // At each level's wrap, bring its next slot down first
+            for (int level = 1; level < Levels; ++level) {
+                if (m_current & ((1ULL << (SlotBits*level)) - 1)) break;
+                cascade(level, (m_current >> (SlotBits*level)) & (Slots - 1));
+            }
+
+            Timer* timer = m_wheel[0][m_current & (Slots - 1)];
+            m_wheel[0][m_current & (Slots - 1)] = nullptr;
+            while (timer) {
+                Timer* next = timer->next;
+                due.push_back(std::move(timer->callback));
+                timer->callback = nullptr;
+                timer->armed = false;
+                timer->prev = timer->next = nullptr;
+                timer->slot = nullptr;
+                ++timer->generation;
+                m_free.push_back(timer->index);
+                --m_pending;
+                timer = next;
+            }
+            ++m_current;
+        }
+
+        if (!due.empty()) {
+            m_lock.Unlock();
+            for (Callback& callback : due) callback();
+            due.clear();
+            m_lock.Lock();
+            continue; // Time has moved on
+        }
+
+        m_wakeAt = nextWake();
+        if (m_wakeAt == UINT64_MAX) m_wake.Wait(m_lock);
+        else m_wake.WaitUntil(m_lock, timeOf(m_wakeAt));
+        m_wakeAt = 0; // Awake, so new timers need no signal
+    }
+}
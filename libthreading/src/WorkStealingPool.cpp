@@ -0,0 +1,10 @@
+/*=============================================================================
+    Copyright (c) 2019 Keelin Becker-Wheeler
+    WorkStealingPool.cpp
+    Distributed under the GNU GENERAL PUBLIC LICENSE
+    See https://github.com/keelimeguy/libthreading
+==============================================================================*/
+#include "WorkStealingPool.h"
+
+// Allocate static class variables
+thread_local WorkStealingPool::Worker* WorkStealingPool::m_local = nullptr;
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vector>
+
+#include "Metrics.h"
+#include "Philosopher.h"
+
+// Headless run of num_philosophers as coroutines on num_workers pinned workers (see Coroutine.h),
+// for far more philosophers than threads allow; returns how each fared
+// - Thinking and eating sleep on a TimerWheel, forks are AsyncMutexes, so a waiting
+//   philosopher costs only its coroutine frame
+// - Times come from seed alone, so runs are repeatable (up to scheduling)
+// - Only the try, ordered and backoff strategies, and only in builds with the coroutine layer
+//   (cmake -DCOROUTINES=ON), otherwise nothing is run and the result is empty
+std::vector<DinerStats> philosopher_banquet(int num_philosophers, int min_time, int max_time, int duration,
+    Strategy strategy, int num_workers, unsigned seed);
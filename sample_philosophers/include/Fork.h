@@ -14,6 +14,12 @@ public:
         return false;
     }
 
+    // Wait for the fork to be put down, then pick it up
+    void Take(int id) {
+        Lock();
+        m_holder = id;
+    }
+
     void PutDown() {
         m_holder = -1;
         Unlock();
@@ -48,3 +54,18 @@ private:
     bool m_held;
     int m_id;
 };
+
+// Acts as a ScopedLock of fork, waiting for it if held by someone else
+class TakeFork {
+public:
+    TakeFork(Fork* fork, int id)
+        : m_fork(fork)
+    {
+        m_fork->Take(id);
+    }
+
+    ~TakeFork() { m_fork->PutDown(); }
+
+private:
+    Fork* m_fork;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// How one philosopher fared (only touched by its own thread until it has left)
+struct DinerStats {
+    static const int Buckets = 32; // Hungry waits by power of two microseconds
+
+    int id = 0;
+    long meals = 0;
+    long retries = 0; // Failed attempts at both forks (try and backoff strategies)
+    uint64_t waitUs = 0; // Total time spent hungry
+    uint64_t maxWaitUs = 0;
+    uint64_t waits[Buckets] = {};
+
+    // A meal after being hungry for wait_us
+    void Ate(uint64_t wait_us);
+};
+
+// Jain's fairness index of x: 1 when all are equal, down to 1/n when one gets everything
+double jain_fairness(const std::vector<double>& x);
+
+// Per philosopher meals/sec and hungry waits (unless !rows), then totals, wait percentiles and fairness
+void report_meals(std::ostream& out, const std::vector<DinerStats>& stats, double seconds, bool rows = true);
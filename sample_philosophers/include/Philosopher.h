@@ -1,24 +1,55 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <string>
 #include <unistd.h>
+#include <vector>
 
+#include "Condition.h"
 #include "Core.h"
 #include "Thread.h"
+#include "TimerWheel.h"
 #include "Fork.h"
+#include "Metrics.h"
 #include "Screen.h"
 
 #define DATA_HEIGHT 40 // Show 40 philosopher entries per column
 #define LINESTART 6 // Row offset, due to argument printout and etc
 
-void philospher_simulation(int num_philosophers, int min_time, int max_time, int duration, bool use_center);
+// How a hungry philosopher gets hold of both forks
+enum class Strategy {
+    TryRetry, // Try both forks, put down and try again at once (may livelock)
+    Ordered, // Wait for the lower addressed fork first, then the other (no cycle, no deadlock)
+    Backoff, // Try both forks, put down and wait a random, doubling time before trying again
+    ChandyMisra // Ask neighbors for forks by message, dirty forks are handed over on request
+};
+
+// Parse "try", "ordered", "backoff" or "chandy-misra", returns false for anything else
+bool strategy_from_name(const std::string& name, Strategy& strategy);
+const char* strategy_name(Strategy strategy);
+
+// Runs the simulation and returns how each philosopher fared
+// (fps > 0 draws the table from a render thread at that frame rate, rather than from every philosopher)
+std::vector<DinerStats> philospher_simulation(int num_philosophers, int min_time, int max_time, int duration,
+    bool use_center, Strategy strategy, int fps, unsigned seed);
 
 // Abstracts functions of philosopher and handles functions in own thread
 class Philosopher {
 public:
-    Philosopher(int id, Fork* left, Fork* right, int think_time_us, int eat_time_us)
-        : m_id(id), m_LeftFork(left), m_RightFork(right), m_uThinkTime(think_time_us), m_uEatTime(eat_time_us)
+    Philosopher(int id, Fork* left, Fork* right, int think_time_us, int eat_time_us, uint32_t seed)
+        : m_id(id), m_LeftFork(left), m_RightFork(right), m_uThinkTime(think_time_us), m_uEatTime(eat_time_us),
+          m_Seed(seed | 1)
     {
+        m_Stats.id = id;
+
         { // We need to print in critical sections so to not overlap print output
             ScopedMutex guard(Screen::lock);
             if (Screen::IsVerbose()) { // If not using fancy visualization then just print the state transition
@@ -26,131 +57,357 @@ public:
                     << think_time_us << ",eat:" << eat_time_us << ")..\n";
             } else {
                 // Write the state transition at the correct position in the table
-                Screen::WriteAt(m_id%DATA_HEIGHT + LINESTART+4, 17*(int)(m_id/DATA_HEIGHT), "%d: invited ", m_id);
+                Screen::WriteAt(m_id%DATA_HEIGHT + LINESTART+4, 17*(int)(m_id/DATA_HEIGHT), "%d: %-8s", m_id, s_Labels[Invited]);
             }
         }
+    }
+
+    // Introduce the neighbors sharing our left and right forks (nullptr if the forks are our own),
+    // the lower id starts out holding each shared fork (dirty), the other its request token
+    void Meet(Philosopher* left, Philosopher* right) {
+        m_Neighbor[Left] = left;
+        m_Neighbor[Right] = right;
+        for (int side : {Left, Right}) {
+            Philosopher* neighbor = m_Neighbor[side];
+            m_Side[side].fork = !neighbor || m_id < neighbor->GetId();
+            m_Side[side].dirty = true;
+            m_Side[side].token = !m_Side[side].fork;
+        }
+    }
 
-        // Begin the philosopher thread
-        m_Thread = Core::MakeThread<void,Philosopher*>(-1, philosopher_task, this);
+    // Begin the philosopher thread (once all have met), on a small (recycled) stack rather than the default 8 MB
+    void Arrive() {
+        char name[16];
+        snprintf(name, sizeof(name), "philosopher %d", m_id);
+        m_Thread = Core::MakeThread<void,Philosopher*>(ThreadAttr().StackSize(StackSize).Name(name), philosopher_task, this);
     }
 
     Thread<void,Philosopher*>* GetThread() { return m_Thread.get(); }
     inline int GetId() { return m_id; }
 
+    // Only stable once the thread has been joined
+    const DinerStats& GetStats() { return m_Stats; }
+
     // Check whether thread needs to exit (exit if not present)
     inline bool IsPresent() { return m_Present; }
 
-    // Trigger the thread to exit
+    // Trigger the thread to exit (waking it if thinking, eating or waiting on neighbors)
     void Leave() {
+        ScopedMutex guard(m_lock);
         m_Present = false;
+        m_Wake.Broadcast();
     }
 
     // Tell the application to allow use of center fork
     static void UseCenter() { s_UseCenter = true; };
 
+    static void UseStrategy(Strategy strategy) { s_Strategy = strategy; }
+
+    // Timer thread that ends every philosopher's thinking, eating and backoff
+    // (must be stopped before the philosophers are destroyed)
+    static void UseTimers(TimerWheel* timers) { s_Timers = timers; }
+
+    // Screen::DrawFunc for render mode: slot 0 is the center fork holder, then philosopher slot-1
+    static void Draw(int slot, int state) {
+        if (slot == CenterSlot) {
+            Screen::Put(LINESTART, 0, "(center holder: %d)\t\t\t\t\t\t", state);
+            return;
+        }
+        int id = slot - 1;
+        Screen::Put(id%DATA_HEIGHT + LINESTART+4, 17*(int)(id/DATA_HEIGHT), "%d: %-8s", id, s_Labels[state]);
+    }
+
 private:
+    static const size_t StackSize = 128*1024; // Ample for the screen output
+    static const int MinBackoff = 16; // us, doubled on every failed try
+    static const int MaxBackoff = 16*1024;
+
+    static const int CenterSlot = 0; // In render mode
+
+    enum { Left, Right };
+
+    enum State { Invited, Arrived, Thinking, Hungry, Eating, Full, Leaving };
+    static const char* const s_Transitions[]; // Verbose output, by State
+    static const char* const s_Labels[]; // Table output, by State
+
+    // A fork or its request token, sent to a neighbor (side is the receiver's)
+    struct Message {
+        bool fork;
+        int side;
+    };
+
+    // What we know of the fork shared with one neighbor (Chandy-Misra only)
+    struct Side {
+        bool fork = false; // We hold it
+        bool dirty = false; // Used since we got it, so must give it up when asked
+        bool token = false; // We hold the request token, i.e. may ask for the fork or have been asked
+    };
+
     // Create a center fork that any philosopher can use in replacement of their own fork
     static Fork s_CenterFork;
-    static bool s_UseCenter; // (only used if enabled)
+    static bool s_UseCenter; // (only used if enabled, by the try and backoff strategies)
+    static Strategy s_Strategy;
+    static TimerWheel* s_Timers;
 
     int m_id;
     Fork *m_LeftFork, *m_RightFork;
     int m_uThinkTime, m_uEatTime; // How long it takes to think/eat
+    uint32_t m_Seed; // For backoff jitter
+
+    std::atomic<bool> m_Present{true}; // If the philosopher is present we will keep running the thread
+    Mutex m_lock; // Guards leaving, m_Due and the Chandy-Misra state below
+    Condition m_Wake; // Signalled by Leave(), the timer and neighbor messages
+    bool m_Due = false; // The timer of spend() has fired
 
-    bool m_Present = true; // If the philosopher is present we will keep running the thread
+    Philosopher* m_Neighbor[2] = {nullptr, nullptr};
+    Side m_Side[2];
+    bool m_Hungry = false, m_Eating = false;
+    std::deque<Message> m_Mail; // Received, not yet handled
+    std::vector<Message> m_Outbox; // To send once m_lock is released (own thread only)
+
+    DinerStats m_Stats;
+    MonotonicClock::time_point m_HungrySince;
     std::shared_ptr<Thread<void,Philosopher*>> m_Thread;
 
-    void think() {
-        {
-            ScopedMutex guard(Screen::lock);
-            if (Screen::IsVerbose()) { // If not using fancy visualization then just print the state transition
-                std::cout << "Philosopher " << m_id << " is thinking..\n";
-            } else {
-                // Write the state transition at the correct position in the table
-                Screen::WriteAt(m_id%DATA_HEIGHT + LINESTART+4, 17*(int)(m_id/DATA_HEIGHT), "%d: thinking", m_id);
-            }
+    // Show a state transition
+    void show(State state) {
+        // Leave it to the render thread if there is one
+        if (Screen::IsRendering()) {
+            Screen::SetState(m_id + 1, state);
+            return;
+        }
+
+        ScopedMutex guard(Screen::lock);
+        if (Screen::IsVerbose()) { // If not using fancy visualization then just print the state transition
+            std::cout << "Philosopher " << m_id << " " << s_Transitions[state] << "..\n";
+        } else {
+            // Write the state transition at the correct position in the table
+            Screen::WriteAt(m_id%DATA_HEIGHT + LINESTART+4, 17*(int)(m_id/DATA_HEIGHT), "%d: %-8s", m_id, s_Labels[state]);
         }
-        // Simply wait a given amount of time for thinking
-        usleep(m_uThinkTime);
     }
 
-    void eat() {
-        {
-            ScopedMutex guard(Screen::lock);
-            if (Screen::IsVerbose()) { // If not using fancy visualization then just print the state transition
-                std::cout << "Philosopher " << m_id << " is hungry..\n";
-            } else {
-                // Write the state transition at the correct position in the table
-                Screen::WriteAt(m_id%DATA_HEIGHT + LINESTART+4, 17*(int)(m_id/DATA_HEIGHT), "%d: hungry  ", m_id);
+    // Called by a neighbor
+    void deliver(Message message) {
+        ScopedMutex guard(m_lock);
+        m_Mail.push_back(message);
+        m_Wake.Signal();
+    }
+
+    // Send the outbox, m_lock must not be held (neighbors take their own lock)
+    void post() {
+        for (Message message : m_Outbox)
+            m_Neighbor[message.side]->deliver({message.fork, 1 - message.side});
+        m_Outbox.clear();
+    }
+
+    // Ask for the fork on side, if hungry and it is ours to ask (m_lock held)
+    void request(int side) {
+        Side& s = m_Side[side];
+        if (m_Hungry && s.token && !s.fork) {
+            s.token = false;
+            m_Outbox.push_back({false, side});
+        }
+    }
+
+    // Hand over the fork on side if asked for and dirty, unless eating with it (m_lock held)
+    void serve(int side) {
+        Side& s = m_Side[side];
+        if (s.token && s.fork && s.dirty && !m_Eating) {
+            s.fork = false;
+            m_Outbox.push_back({true, side});
+            request(side); // Straight away want it back if hungry
+        }
+    }
+
+    void receive(Message message) {
+        Side& s = m_Side[message.side];
+        if (message.fork) {
+            s.fork = true;
+            s.dirty = false; // Cleaned on the way
+        } else {
+            s.token = true;
+            serve(message.side);
+        }
+    }
+
+    // Wait until ready() (checked with m_lock held) or Leave(), handling neighbor
+    // messages meanwhile; returns false only if cut short by Leave()
+    bool await(const std::function<bool()>& ready) {
+        m_lock.Lock();
+        for (;;) {
+            while (!m_Mail.empty()) {
+                receive(m_Mail.front());
+                m_Mail.pop_front();
+            }
+            if (!m_Outbox.empty()) {
+                m_lock.Unlock();
+                post();
+                m_lock.Lock();
+                continue;
+            }
+
+            if (!m_Present) {
+                m_lock.Unlock();
+                return false;
             }
+            if (ready()) {
+                m_lock.Unlock();
+                return true;
+            }
+
+            m_Wake.Wait(m_lock);
         }
+    }
+
+    // Spend the given time (us), returns false if cut short by Leave()
+    // - The shared timer thread wakes us, rather than each philosopher arming a kernel timeout
+    bool spend(int time_us) {
+        auto timer = s_Timers->After(std::chrono::microseconds(time_us), [this]() {
+            ScopedMutex guard(m_lock);
+            m_Due = true;
+            m_Wake.Signal();
+        });
+
+        bool spent = await([this]() {
+            if (!m_Due) return false;
+            m_Due = false;
+            return true;
+        });
+        if (!spent) s_Timers->Cancel(timer); // (may already be running, the wheel stops before we go)
+        return spent;
+    }
+
+    void think() {
+        show(Thinking);
+
+        // Simply wait a given amount of time for thinking
+        spend(m_uThinkTime);
+    }
 
-        for (;;) { // Try to pick up forks forever (and end after successful)
+    // Eat with both forks in hand
+    void dine() {
+        auto waited = std::chrono::duration_cast<std::chrono::microseconds>(MonotonicClock::now() - m_HungrySince);
+        m_Stats.Ate(waited.count());
 
-            // Try the left fork
-            ChooseFork left(m_LeftFork, m_id);
+        show(Eating);
+
+        // Wait a given amount of time for eating (cut short if leaving)
+        spend(m_uEatTime);
+
+        show(Full);
+    }
 
-            // Try the right fork
-            ChooseFork right(m_RightFork, m_id);
+    // One go at picking up both forks without waiting, eating if it worked
+    bool tryEat() {
+        // Try the left fork
+        ChooseFork left(m_LeftFork, m_id);
 
-            // We can only eat if we have two forks
-            bool can_eat = left.IsHeld() && right.IsHeld();
+        // Try the right fork
+        ChooseFork right(m_RightFork, m_id);
 
-            // Try the center fork if enabled and we managed to pickup one fork
-            bool try_center = s_UseCenter && !can_eat && (left.IsHeld() || right.IsHeld());
+        // We can only eat if we have two forks
+        bool can_eat = left.IsHeld() && right.IsHeld();
 
-            // We use this inline if in order to keep "center" in the current scope until finished
-            ChooseFork center(try_center ? &s_CenterFork : nullptr, m_id);
-            if (try_center) can_eat = center.IsHeld();
+        // Try the center fork if enabled and we managed to pickup one fork
+        bool try_center = s_UseCenter && !can_eat && (left.IsHeld() || right.IsHeld());
 
-            if (s_UseCenter && !Screen::IsVerbose()) { // Print the holder of center fork, for record keeping
+        // We use this inline if in order to keep "center" in the current scope until finished
+        ChooseFork center(try_center ? &s_CenterFork : nullptr, m_id);
+        if (try_center) can_eat = center.IsHeld();
+
+        if (s_UseCenter && !Screen::IsVerbose()) { // Print the holder of center fork, for record keeping
+            if (Screen::IsRendering()) {
+                Screen::SetState(CenterSlot, s_CenterFork.Holder());
+            } else {
                 ScopedMutex guard(Screen::lock);
                 Screen::WriteAt(LINESTART, 0, "(center holder: %d)\t\t\t\t\t\t", s_CenterFork.Holder());
             }
+        }
+
+        // If we have two forks, then finally eat
+        if (can_eat) dine();
+        return can_eat;
+    }
+
+    void eatTryRetry() {
+        // Try to pick up forks until successful (or leaving)
+        while (IsPresent() && !tryEat()) ++m_Stats.retries;
+    }
+
+    void eatOrdered() {
+        // Every philosopher waits on forks in the same global order, so no wait cycle can form
+        bool left_first = std::less<Fork*>()(m_LeftFork, m_RightFork);
+        TakeFork first(left_first ? m_LeftFork : m_RightFork, m_id);
+        TakeFork second(left_first ? m_RightFork : m_LeftFork, m_id);
+        dine();
+    }
+
+    void eatBackoff() {
+        int backoff = MinBackoff;
+        while (!tryEat()) {
+            ++m_Stats.retries;
+
+            // Random jitter keeps neighbors from retrying in lockstep
+            m_Seed ^= m_Seed << 13;
+            m_Seed ^= m_Seed >> 17;
+            m_Seed ^= m_Seed << 5;
+            if (!spend(1 + m_Seed % backoff)) return;
+            backoff = std::min(2*backoff, MaxBackoff);
+        }
+    }
 
-            // If we have two forks, then finally eat
-            if (can_eat) {
-                {
-                    ScopedMutex guard(Screen::lock);
-                    if (Screen::IsVerbose()) { // If not using fancy visualization then just print the state transition
-                        std::cout << "Philosopher " << m_id << " is eating..\n";
-                    } else {
-                        // Write the state transition at the correct position in the table
-                        Screen::WriteAt(m_id%DATA_HEIGHT + LINESTART+4, 17*(int)(m_id/DATA_HEIGHT), "%d: eating  ", m_id);
-                    }
-                }
-
-                // Wait a given amount of time for eating
-                usleep(m_uEatTime);
-
-                {
-                    ScopedMutex guard(Screen::lock);
-                    if (Screen::IsVerbose()) { // If not using fancy visualization then just print the state transition
-                        std::cout << "Philosopher " << m_id << " is full..\n";
-                    } else {
-                       // Write the state transition at the correct position in the table
-                        Screen::WriteAt(m_id%DATA_HEIGHT + LINESTART+4, 17*(int)(m_id/DATA_HEIGHT), "%d: full    ", m_id);
-                    }
-                }
-
-                // Break from the loop since we just ate
-                return;
+    void eatChandyMisra() {
+        {
+            ScopedMutex guard(m_lock);
+            m_Hungry = true;
+            request(Left);
+            request(Right);
+        }
+
+        // Clean forks are kept until eaten with, so both do arrive
+        bool fed = await([this]() {
+            if (!m_Side[Left].fork || !m_Side[Right].fork) return false;
+            m_Hungry = false;
+            m_Eating = true;
+            return true;
+        });
+        if (!fed) return;
+
+        {
+            // The protocol alone decides who eats, the fork mutexes only check it
+            ChooseFork left(m_LeftFork, m_id), right(m_RightFork, m_id);
+            assert(left.IsHeld() && right.IsHeld());
+            dine();
+        }
+
+        // Now dirty, hand over any forks asked for while eating
+        {
+            ScopedMutex guard(m_lock);
+            m_Eating = false;
+            for (int side : {Left, Right}) {
+                m_Side[side].dirty = true;
+                serve(side);
             }
         }
+        post();
+    }
+
+    void eat() {
+        show(Hungry);
+        m_HungrySince = MonotonicClock::now();
+
+        switch (s_Strategy) {
+            case Strategy::TryRetry: eatTryRetry(); break;
+            case Strategy::Ordered: eatOrdered(); break;
+            case Strategy::Backoff: eatBackoff(); break;
+            case Strategy::ChandyMisra: eatChandyMisra(); break;
+        }
     }
 
     // Define the thread function:
     // --  void* philosopher_task(Philosopher** arg)
     static THREAD_FUNC(philosopher_task, void,Philosopher*) {
-        {
-            ScopedMutex guard(Screen::lock);
-            if (Screen::IsVerbose()) { // If not using fancy visualization then just print the state transition
-                std::cout << "Philosopher " << (*arg)->GetId() << " has arrived..\n";
-            } else {
-                // Write the state transition at the correct position in the table
-                Screen::WriteAt((*arg)->GetId()%DATA_HEIGHT + LINESTART+4, 17*(int)((*arg)->GetId()/DATA_HEIGHT), "%d: arrived ", (*arg)->GetId());
-            }
-        }
+        (*arg)->show(Arrived);
 
         // Perform tasks until triggered to stop
         while ((*arg)->IsPresent()) {
@@ -160,15 +417,7 @@ private:
             (*arg)->eat();
         }
 
-        {
-            ScopedMutex guard(Screen::lock);
-            if (Screen::IsVerbose()) { // If not using fancy visualization then just print the state transition
-                std::cout << "Philosopher " << (*arg)->GetId() << " is leaving..\n";
-            } else {
-                // Write the state transition at the correct position in the table
-                Screen::WriteAt((*arg)->GetId()%DATA_HEIGHT + LINESTART+4, 17*(int)((*arg)->GetId()/DATA_HEIGHT), "%d: leaving ", (*arg)->GetId());
-            }
-        }
+        (*arg)->show(Leaving);
 
         THREAD_RETURN(nullptr);
     }
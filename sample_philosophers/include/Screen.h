@@ -1,16 +1,29 @@
 #pragma once
 
+#include "Condition.h"
 #include "Mutex.h"
+#include "PerCore.h"
+#include "Thread.h"
 
 #include <stdlib.h>
+#include <atomic>
 #include <cstdio>
+#include <functional>
+#include <memory>
 #include <ncurses.h>
+#include <vector>
 
 // Allows abstraction of print statements for use with console or ncurses
+// - Render mode (ncurses only): workers just SetState() their slot, without locking or drawing,
+//   and one render thread redraws the slots that changed at a fixed frame rate, so workers
+//   never wait on the terminal
 class Screen {
 public:
     static Mutex lock; // Defines a global lock to protect print statements
 
+    // Draws one slot in its given state, called by the render thread with lock held
+    typedef std::function<void(int slot, int state)> DrawFunc;
+
     static void Init(bool verbose) {
         s_verbose = verbose;
 
@@ -54,9 +67,44 @@ public:
         s_col = 0;
     }
 
+    // Print without refreshing, for DrawFunc (the render thread refreshes once per frame)
+    template <typename... Args>
+    static void Put(int row, int col, Args... args) {
+        mvprintw(row, col, args...);
+    }
+
     static inline bool IsVerbose() { return s_verbose; }
 
+    // Start the render thread over num_slots slots (all unset, so not drawn), ignored if verbose
+    static void StartRender(int num_slots, int fps, DrawFunc draw);
+
+    // Stop the render thread, after drawing the final states
+    static void StopRender();
+
+    static inline bool IsRendering() { return s_rendering; }
+
+    // Lock free, only the latest state of a slot is drawn
+    static inline void SetState(int slot, int state) {
+        (*s_slots)[slot].store(state, std::memory_order_relaxed);
+    }
+
 private:
     static int s_row, s_col;
     static bool s_verbose;
+
+    static bool s_rendering;
+    static std::unique_ptr<PaddedArray<std::atomic<int>>> s_slots; // Own cache line each, so workers' stores don't contend
+    static std::vector<int> s_drawn; // Last drawn state of each slot (render thread only)
+    static DrawFunc s_draw;
+    static std::chrono::nanoseconds s_frame;
+
+    static Mutex s_renderLock; // Guards stopping, taken before lock
+    static Condition s_renderWake;
+    static bool s_stopping;
+    static std::unique_ptr<Thread<void>> s_renderer;
+
+    static void render();
+
+    // Draw the slots that changed since the last frame
+    static void drawFrame();
 };
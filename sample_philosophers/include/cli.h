@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <string>
 
 // The command line interface,
 // based on examples from-> https://github.com/pfultz2/args
@@ -20,6 +21,11 @@ struct cli {
     static int max_time;
     static bool use_center;
     static int duration;
+    static std::string strategy;
+    static int fps;
+    static bool headless;
+    static int workers;
+    static int seed;
     static bool verbose;
     static bool valid;
 
@@ -31,15 +37,21 @@ struct cli {
         f(max_time, "--max_time", "-M", args::help("The maximum wait time (us) for thinking and eating. (default=2000000)"));
         f(use_center, "--use_center", "-c", args::help("Enable option to use center fork."));
         f(duration, "--duration", "-t", args::help("Run for the given amount of seconds then exit. (default=0, user triggers exit)"));
+        f(fps, "--fps", "-f", args::help("Redraw the table from one render thread at this rate, or 0 to draw from every philosopher. (default=30)"));
+        f(strategy, "--strategy", "-s", args::help("How to pick up forks: try, ordered, backoff or chandy-misra. (default=try)"));
+        f(seed, "--seed", "-S", args::help("Seed for the thinking and eating times. (default=1)"));
+        f(headless, "--headless", "-H", args::help("Run philosophers as coroutines on pinned workers without output, and report throughput (needs -DCOROUTINES=ON)."));
+        f(workers, "--workers", "-w", args::help("Number of workers when headless. (default=0, one per available CPU)"));
     }
 
     void run() {
-        valid = (num_philosophers>0 && min_time>0 && max_time>=min_time && duration>=0);
+        valid = (num_philosophers>0 && min_time>0 && max_time>=min_time && duration>=0 && fps>=0 && workers>=0);
 
         // Fixes the odd behavior of the vendor library,
         // e.g. so that now the flag -v results in verbose=true (else false without flag use)
         verbose = !verbose;
         use_center = !use_center;
+        headless = !headless;
 
         // Report arguments, for benefit of record keeping
         std::cout << "Args:"
@@ -48,7 +60,12 @@ struct cli {
             << "\n\tmin_time=" << min_time
             << "\n\tmax_time=" << max_time
             << "\n\tuse_center=" << (use_center?"true":"false")
-            << "\n\tduration=" << duration << std::endl;
+            << "\n\tduration=" << duration
+            << "\n\tstrategy=" << strategy
+            << "\n\tfps=" << fps
+            << "\n\tseed=" << seed
+            << "\n\theadless=" << (headless?"true":"false")
+            << "\n\tworkers=" << workers << std::endl;
     }
 };
 
@@ -59,6 +76,11 @@ int cli::num_philosophers = 8;
 int cli::min_time = 1000000;
 int cli::max_time = 2000000;
 int cli::duration = 0;
+std::string cli::strategy = "try";
+int cli::fps = 30;
+int cli::workers = 0;
+int cli::seed = 1;
 // Due to how the args library works these are opposite valued..
 bool cli::verbose = true;
 bool cli::use_center = true;
+bool cli::headless = true;
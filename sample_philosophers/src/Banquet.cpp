@@ -0,0 +1,150 @@
+#include "Banquet.h"
+
+#include <iostream>
+
+#ifdef LIBTHREADING_COROUTINES
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unistd.h>
+
+#include "Async.h"
+#include "Core.h"
+#include "Coroutine.h"
+#include "TimerWheel.h"
+
+static const int MinBackoff = 16; // us, doubled on every failed try
+static const int MaxBackoff = 16*1024;
+
+// Everything the diners share
+// (the timers are declared after the executor they schedule onto, so stop first)
+struct Table {
+    Executor executor;
+    TimerWheel timers{std::chrono::microseconds(100)};
+    std::unique_ptr<AsyncMutex[]> forks;
+    std::atomic<bool> open{true};
+
+    Table(int num_workers, int num_forks) : executor(num_workers), forks(new AsyncMutex[num_forks]) {}
+};
+
+// co_await Nap{table, time_us}: suspend for time_us, then be resumed by the timer thread onto the workers
+struct Nap {
+    Table& table;
+    int time_us;
+
+    bool await_ready() { return time_us <= 0; }
+    void await_suspend(std::coroutine_handle<> handle) {
+        Executor* executor = &table.executor;
+        table.timers.After(std::chrono::microseconds(time_us), [executor, handle]() { executor->Schedule(handle); });
+    }
+    void await_resume() {}
+};
+
+static uint32_t xorshift(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static bool try_forks(AsyncMutex* left, AsyncMutex* right) {
+    if (!left->TryLock()) return false;
+    if (right->TryLock()) return true;
+    left->Unlock();
+    return false;
+}
+
+static Task<void> diner(Table& table, DinerStats& stats, AsyncMutex* left, AsyncMutex* right,
+    int think_time_us, int eat_time_us, Strategy strategy, uint32_t seed)
+{
+    while (table.open.load(std::memory_order_relaxed)) {
+        co_await Nap{table, think_time_us};
+        if (!table.open.load(std::memory_order_relaxed)) break;
+
+        auto hungry_since = MonotonicClock::now();
+        if (strategy == Strategy::Ordered) {
+            // Same global order for everyone, so no wait cycle can form
+            bool left_first = std::less<AsyncMutex*>()(left, right);
+            co_await (left_first ? left : right)->Lock();
+            co_await (left_first ? right : left)->Lock();
+        } else {
+            int backoff = MinBackoff;
+            while (!try_forks(left, right)) {
+                ++stats.retries;
+                if (!table.open.load(std::memory_order_relaxed)) co_return;
+
+                if (strategy == Strategy::Backoff) {
+                    co_await Nap{table, 1 + (int)(xorshift(seed) % backoff)};
+                    backoff = std::min(2*backoff, MaxBackoff);
+                } else {
+                    co_await table.executor.Yield();
+                }
+            }
+        }
+
+        auto waited = std::chrono::duration_cast<std::chrono::microseconds>(MonotonicClock::now() - hungry_since);
+        stats.Ate(waited.count());
+
+        co_await Nap{table, eat_time_us};
+        left->Unlock();
+        right->Unlock();
+    }
+}
+
+std::vector<DinerStats> philosopher_banquet(int num_philosophers, int min_time, int max_time, int duration,
+    Strategy strategy, int num_workers, unsigned seed)
+{
+    std::vector<DinerStats> stats;
+
+    // Check for valid arguments
+    if (num_philosophers <= 0 || min_time <= 0 || max_time < min_time || duration < 0 || num_workers <= 0) return stats;
+    if (strategy == Strategy::ChandyMisra) {
+        std::cout << "The chandy-misra strategy is not available headless\n";
+        return stats;
+    }
+
+    // Allocate enough forks
+    int num_forks = (num_philosophers == 1) ? 2 : num_philosophers;
+    Table table(num_workers, num_forks);
+    stats.resize(num_philosophers);
+
+    std::cout << "Inviting " << num_philosophers << " philosophers to " << num_workers << " workers..\n";
+    if (!duration) std::cout << "\n[Type a key to exit the program.]\n\n";
+
+    uint32_t rng = seed*2654435761u | 1;
+    for (int i = 0; i < num_philosophers; ++i) {
+        // Create thinking and eating durations, based on argument bounds
+        int think_time_us = xorshift(rng) % (max_time-min_time+1) + min_time;
+        int eat_time_us = xorshift(rng) % (max_time-min_time+1) + min_time;
+
+        // Philosopher i shares its left fork with i+1 and its right fork with i-1
+        stats[i].id = i;
+        table.executor.Spawn(diner(table, stats[i], &table.forks[i], &table.forks[(i+num_forks-1) % num_forks],
+            think_time_us, eat_time_us, strategy, xorshift(rng)));
+    }
+
+    // Wait given amount of time before exiting
+    if (duration) sleep(duration);
+
+    // Wait on user input to exit program
+    else std::cin.get();
+
+    // Everyone finishes their current nap or meal, then leaves
+    table.open.store(false, std::memory_order_relaxed);
+    table.executor.WaitIdle();
+
+    return stats;
+}
+
+#else
+
+std::vector<DinerStats> philosopher_banquet(int, int, int, int, Strategy, int, unsigned) {
+    std::cout << "Headless mode needs the coroutine layer (cmake -DCOROUTINES=ON)\n";
+    return std::vector<DinerStats>();
+}
+
+#endif
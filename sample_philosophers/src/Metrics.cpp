@@ -0,0 +1,74 @@
+#include "Metrics.h"
+
+#include <algorithm>
+#include <iomanip>
+
+void DinerStats::Ate(uint64_t wait_us) {
+    ++meals;
+    waitUs += wait_us;
+    maxWaitUs = std::max(maxWaitUs, wait_us);
+
+    int bucket = wait_us ? 64 - __builtin_clzll(wait_us) : 0;
+    ++waits[std::min(bucket, Buckets - 1)];
+}
+
+double jain_fairness(const std::vector<double>& x) {
+    double sum = 0, squares = 0;
+    for (double v : x) {
+        sum += v;
+        squares += v*v;
+    }
+    return squares ? sum*sum / (x.size()*squares) : 1;
+}
+
+// Upper bound (us) of the bucket covering fraction of the waits
+static uint64_t percentile(const uint64_t* waits, double fraction) {
+    uint64_t total = 0;
+    for (int i = 0; i < DinerStats::Buckets; ++i) total += waits[i];
+    if (!total) return 0;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < DinerStats::Buckets; ++i) {
+        seen += waits[i];
+        if (seen >= fraction*total) return 1ULL << i;
+    }
+    return 1ULL << (DinerStats::Buckets - 1);
+}
+
+void report_meals(std::ostream& out, const std::vector<DinerStats>& stats, double seconds, bool rows) {
+    DinerStats all;
+    std::vector<double> rates;
+
+    if (rows) out << std::setw(6) << "id" << std::setw(10) << "meals" << std::setw(12) << "meals/s"
+        << std::setw(10) << "retries" << std::setw(14) << "mean wait ms" << std::setw(13) << "max wait ms"
+        << std::setw(13) << "p99 wait ms" << "\n";
+
+    out << std::fixed;
+    for (const DinerStats& diner : stats) {
+        double rate = seconds > 0 ? diner.meals / seconds : 0;
+        rates.push_back(rate);
+
+        if (rows) out << std::setw(6) << diner.id << std::setw(10) << diner.meals
+            << std::setprecision(2) << std::setw(12) << rate << std::setw(10) << diner.retries
+            << std::setprecision(3) << std::setw(14) << (diner.meals ? diner.waitUs/1e3/diner.meals : 0)
+            << std::setw(13) << diner.maxWaitUs/1e3 << std::setw(13) << percentile(diner.waits, 0.99)/1e3 << "\n";
+
+        all.meals += diner.meals;
+        all.retries += diner.retries;
+        all.waitUs += diner.waitUs;
+        all.maxWaitUs = std::max(all.maxWaitUs, diner.maxWaitUs);
+        for (int i = 0; i < DinerStats::Buckets; ++i) all.waits[i] += diner.waits[i];
+    }
+
+    out << std::setprecision(2)
+        << (rows ? "\n" : "") << "meals: " << all.meals << " (" << (seconds > 0 ? all.meals / seconds : 0) << "/s)"
+        << "   retries: " << all.retries
+        << std::setprecision(3)
+        << "\nhungry wait ms: mean " << (all.meals ? all.waitUs/1e3/all.meals : 0)
+        << "   p50 <" << percentile(all.waits, 0.5)/1e3
+        << "   p90 <" << percentile(all.waits, 0.9)/1e3
+        << "   p99 <" << percentile(all.waits, 0.99)/1e3
+        << "   max " << all.maxWaitUs/1e3
+        << "\nfairness (Jain, meals/s): " << jain_fairness(rates) << "\n";
+    out << std::defaultfloat;
+}
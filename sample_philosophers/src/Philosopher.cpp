@@ -9,12 +9,47 @@
 // Allocate static class variables
 Fork Philosopher::s_CenterFork;
 bool Philosopher::s_UseCenter = false;
+Strategy Philosopher::s_Strategy = Strategy::TryRetry;
+TimerWheel* Philosopher::s_Timers = nullptr;
+const char* const Philosopher::s_Transitions[] = {
+    "is invited", "has arrived", "is thinking", "is hungry", "is eating", "is full", "is leaving"
+};
+const char* const Philosopher::s_Labels[] = {
+    "invited", "arrived", "thinking", "hungry", "eating", "full", "leaving"
+};
+
+static const struct { Strategy strategy; const char* name; } s_strategies[] = {
+    {Strategy::TryRetry, "try"},
+    {Strategy::Ordered, "ordered"},
+    {Strategy::Backoff, "backoff"},
+    {Strategy::ChandyMisra, "chandy-misra"},
+};
+
+bool strategy_from_name(const std::string& name, Strategy& strategy) {
+    for (auto& entry : s_strategies) {
+        if (name == entry.name) {
+            strategy = entry.strategy;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* strategy_name(Strategy strategy) {
+    for (auto& entry : s_strategies)
+        if (entry.strategy == strategy) return entry.name;
+    return "?";
+}
+
+std::vector<DinerStats> philospher_simulation(int num_philosophers, int min_time, int max_time, int duration,
+    bool use_center, Strategy strategy, int fps, unsigned seed)
+{
+    std::vector<DinerStats> stats;
 
-void philospher_simulation(int num_philosophers, int min_time, int max_time, int duration, bool use_center) {
     // Check for valid arguments
-    if (num_philosophers <= 0 || min_time <= 0 || max_time <= 0 || duration < 0) return;
+    if (num_philosophers <= 0 || min_time <= 0 || max_time <= 0 || duration < 0) return stats;
 
-    srand(time(0)); // Seed RNG
+    srand(seed); // Seed RNG (fixed, so runs are repeatable)
 
     // Allocate enough forks
     int num_forks = (num_philosophers == 1) ? 2 : num_philosophers;
@@ -22,6 +57,7 @@ void philospher_simulation(int num_philosophers, int min_time, int max_time, int
 
     // Allow use of center fork if requested
     if (use_center) Philosopher::UseCenter();
+    Philosopher::UseStrategy(strategy);
 
     // If no duration given then we will end program on user key input
     if (!duration) {
@@ -47,12 +83,31 @@ void philospher_simulation(int num_philosophers, int min_time, int max_time, int
 
         left = &forks[i]; // Assign left fork
 
-        // Create the philosopher thread
-        philosophers[i] = std::make_shared<Philosopher>(i, left, right, think_time_us, eat_time_us);
+        // Create the philosopher
+        philosophers[i] = std::make_shared<Philosopher>(i, left, right, think_time_us, eat_time_us, rand());
 
         right = left; // Rotate forks to share between neighboring philosophers
     }
 
+    // Our left fork is the left neighbor's right fork, unless alone with two forks of our own
+    for (int i = 0; i < num_philosophers; ++i) {
+        if (num_philosophers == 1) philosophers[i]->Meet(nullptr, nullptr);
+        else philosophers[i]->Meet(philosophers[(i+1) % num_philosophers].get(),
+            philosophers[(i-1+num_philosophers) % num_philosophers].get());
+    }
+
+    // One timer thread wakes every philosopher, in 0.1 ms ticks
+    // (declared after them, so it stops before they are destroyed)
+    TimerWheel timers(std::chrono::microseconds(100));
+    Philosopher::UseTimers(&timers);
+
+    // Philosophers only store their states from here on, if rendering (ignored in verbose mode)
+    if (fps > 0) Screen::StartRender(num_philosophers + 1, fps, Philosopher::Draw);
+
+    // Start the philosopher threads
+    for (auto& philosopher : philosophers)
+        philosopher->Arrive();
+
     // Wait given amount of time before exiting
     if (duration) sleep(duration);
 
@@ -64,4 +119,9 @@ void philospher_simulation(int num_philosophers, int min_time, int max_time, int
         philosopher->Leave();
     for (auto& philosopher : philosophers)
         philosopher->GetThread()->Join();
+    Screen::StopRender();
+
+    for (auto& philosopher : philosophers)
+        stats.push_back(philosopher->GetStats());
+    return stats;
 }
@@ -1,7 +1,79 @@
 #include "Screen.h"
 
+#include <cassert>
+
 // Allocate static class variables
 Mutex Screen::lock;
 int Screen::s_row = 0;
 int Screen::s_col = 0;
 bool Screen::s_verbose = false;
+
+bool Screen::s_rendering = false;
+std::unique_ptr<PaddedArray<std::atomic<int>>> Screen::s_slots;
+std::vector<int> Screen::s_drawn;
+Screen::DrawFunc Screen::s_draw;
+std::chrono::nanoseconds Screen::s_frame;
+
+Mutex Screen::s_renderLock;
+Condition Screen::s_renderWake;
+bool Screen::s_stopping = false;
+std::unique_ptr<Thread<void>> Screen::s_renderer;
+
+void Screen::StartRender(int num_slots, int fps, DrawFunc draw) {
+    assert(!s_rendering && num_slots > 0 && fps > 0);
+    if (s_verbose) return;
+
+    s_slots.reset(new PaddedArray<std::atomic<int>>(num_slots, -1)); // Unset
+    s_drawn.assign(num_slots, -1);
+    s_draw = std::move(draw);
+    s_frame = std::chrono::nanoseconds(1000000000 / fps);
+    s_stopping = false;
+    s_rendering = true;
+
+    s_renderer.reset(new Thread<void>(ThreadAttr().Name("screen"), render));
+}
+
+void Screen::StopRender() {
+    if (!s_rendering) return;
+
+    {
+        ScopedMutex guard(s_renderLock);
+        s_stopping = true;
+        s_renderWake.Signal();
+    }
+    s_renderer.reset(); // Joins, after the final frame
+
+    s_rendering = false;
+    s_slots.reset();
+}
+
+void Screen::render() {
+    auto next = MonotonicClock::now();
+
+    ScopedMutex guard(s_renderLock);
+    while (!s_stopping) {
+        drawFrame();
+
+        // Keep to the frame rate, but don't try to catch up on missed frames
+        next += s_frame;
+        auto now = MonotonicClock::now();
+        if (next < now) next = now;
+        s_renderWake.WaitUntil(s_renderLock, next);
+    }
+    drawFrame();
+}
+
+void Screen::drawFrame() {
+    ScopedMutex guard(lock);
+
+    bool changed = false;
+    for (size_t slot = 0; slot < s_drawn.size(); ++slot) {
+        int state = (*s_slots)[slot].load(std::memory_order_relaxed);
+        if (state == s_drawn[slot]) continue;
+
+        s_draw(slot, state);
+        s_drawn[slot] = state;
+        changed = true;
+    }
+    if (changed) refresh();
+}
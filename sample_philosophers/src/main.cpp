@@ -6,24 +6,27 @@
 #include "Core.h"
 #include "Screen.h"
 #include "Timer.h"
+#include "Banquet.h"
 #include "Philosopher.h"
 
 int main(int argc, char const *argv[]) {
 
     // Parse the command line arguments
     args::parse<cli>(argc, argv);
-    if (!cli::valid) {
+    Strategy strategy;
+    if (!cli::valid || !strategy_from_name(cli::strategy, strategy)) {
         std::cout << "Invalid args. Try: " << argv[0] << " -h\n";
         return 0;
     }
 
-    // Initialize the screen for either fancy table output (!verbose), or list of transitions (verbose)
-    Screen::Init(cli::verbose);
+    // Initialize the screen for either fancy table output (!verbose), or list of transitions (verbose or headless)
+    Screen::Init(cli::verbose || cli::headless);
     Screen::Write("");
 
-    if (!cli::verbose) { // Print the arguments above fancy table output, if enabled
-        Screen::Write("Args:   verbose=%s   num_philosophers=%d   min_time=%d   max_time=%d   use_center=%s   duration=%d",
-        (cli::verbose?"true":"false"), cli::num_philosophers, cli::min_time, cli::max_time, (cli::use_center?"true":"false"), cli::duration);
+    if (!Screen::IsVerbose()) { // Print the arguments above fancy table output, if enabled
+        Screen::Write("Args:   verbose=%s   num_philosophers=%d   min_time=%d   max_time=%d   use_center=%s   duration=%d   strategy=%s   fps=%d",
+        (cli::verbose?"true":"false"), cli::num_philosophers, cli::min_time, cli::max_time, (cli::use_center?"true":"false"), cli::duration,
+        strategy_name(strategy), cli::fps);
         Screen::Write("");
     }
 
@@ -34,15 +37,24 @@ int main(int argc, char const *argv[]) {
     Screen::Write("available CPUs for use: %d\n", Core::Count());
     Screen::Write("(this system has a total of %d possible CPUs)\n", Core::NumProc());
 
-    // Run the philosopher problem simulation
+    // Run the philosopher problem simulation, or the headless banquet
     Timer::Start();
-    philospher_simulation(cli::num_philosophers, cli::min_time, cli::max_time, cli::duration, cli::use_center);
+    auto stats = cli::headless
+        ? philosopher_banquet(cli::num_philosophers, cli::min_time, cli::max_time, cli::duration, strategy,
+            cli::workers ? cli::workers : Core::Count(), cli::seed)
+        : philospher_simulation(cli::num_philosophers, cli::min_time, cli::max_time, cli::duration, cli::use_center, strategy,
+            cli::fps, cli::seed);
     double s = Timer::EllapsedSec();
 
     Screen::Terminate();
+    if (stats.empty()) return 0; // Nothing was run
 
     // Record the time taken for the fun of it!
     std::cout << "\nFinished after " << s << "s\n";
 
+    // So that strategies can be compared
+    std::cout << "\nStrategy: " << strategy_name(strategy) << "\n";
+    report_meals(std::cout, stats, s, !cli::headless);
+
     return 0;
 }
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts hardware/software events of this process through perf_event_open
+// - Counters inherit into threads created after construction, so construct
+//   it before starting the threads to be measured (e.g. a ThreadPool)
+// - Events the kernel refuses (no PMU, perf_event_paranoid, ...) read as unavailable
+class PerfCounters {
+public:
+    enum Event { CYCLES, INSTRUCTIONS, LLC_MISSES, CONTEXT_SWITCHES, NUM_EVENTS };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    static const char* Name(Event event);
+
+    // Zero and start every available counter
+    void Start();
+
+    // Stop counting, the values stay readable
+    void Stop();
+
+    bool Available(Event event) const { return m_fds[event] >= 0; }
+    uint64_t Value(Event event) const;
+
+private:
+    int m_fds[NUM_EVENTS];
+};
@@ -18,6 +18,10 @@ struct cli {
     static int size;
     static int max;
     static int num_threads;
+    static int repeat;
+    static bool pool;
+    static int placement;
+    static bool sweep;
     static bool verbose;
     static bool valid;
 
@@ -27,6 +31,10 @@ struct cli {
         f(size, "--size", "-n", args::help("The size of the random array. (default=1000000)"));
         f(max, "--max", "-M", args::help("The maximum value in the random array. (default=10)"));
         f(num_threads, "--num_threads", "-t", args::help("The number of threads. (default=8)"));
+        f(repeat, "--repeat", "-r", args::help("The number of times to compute the sum. (default=1)"));
+        f(pool, "--pool", "-p", args::help("Reuse a persistent ThreadPool across repeats."));
+        f(placement, "--placement", "-P", args::help("Pin pool workers: 0=unpinned, 1=compact, 2=scatter, 3=physical cores, 4=same L3. (default=0)"));
+        f(sweep, "--sweep", "-S", args::help("Sweep sizes up to size and thread counts up to num_threads, repeat trials each, with perf counters."));
     }
 
     void run() {
@@ -35,11 +43,19 @@ struct cli {
         // Fixes the odd behavior of the vendor library,
         // e.g. so that now the flag -v results in verbose=true (else false without flag use)
         verbose = !verbose;
+        pool = !pool;
+        sweep = !sweep;
+        if (repeat < 1) repeat = 1;
+        if (placement < 0 || placement > 4) placement = 0;
 
         // Report arguments, for benefit of record keeping
         std::cout << "Args:\tsize=" << size
             << "\n\tmax=" << max
             << "\n\tnum_threads=" << num_threads
+            << "\n\trepeat=" << repeat
+            << "\n\tpool=" << (pool?"true":"false")
+            << "\n\tplacement=" << placement
+            << "\n\tsweep=" << (sweep?"true":"false")
             << "\n\tverbose=" << (verbose?"true":"false") << std::endl;
     }
 };
@@ -50,5 +66,9 @@ bool cli::valid = false;
 int cli::size = 1000000;
 int cli::max = 10;
 int cli::num_threads = 8;
+int cli::repeat = 1;
+int cli::placement = 0;
 // Due to how the args library works these are opposite valued..
 bool cli::verbose = true;
+bool cli::pool = true;
+bool cli::sweep = true;
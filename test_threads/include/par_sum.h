@@ -1,3 +1,6 @@
 #pragma once
 
+class ThreadPool;
+
 long par_sum(int *arr, int size, int num_threads);
+long par_sum(int *arr, int size, ThreadPool& pool); // Reuses the pool's workers
@@ -0,0 +1,8 @@
+#pragma once
+
+// Times par_sum over array sizes from 10^4 up to max_size (in powers of ten)
+// and thread counts from 1 up to max_threads (doubling), trials times each,
+// printing the median time, speedup and efficiency over one thread, memory
+// bandwidth and per trial perf counters of every configuration
+// - placement is as for the sum -P option (0 leaves workers unpinned)
+void sweep(int max_size, int max_value, int max_threads, int trials, int placement);
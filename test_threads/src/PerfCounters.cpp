@@ -0,0 +1,62 @@
+#include "PerfCounters.h"
+
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int open_counter(uint32_t type, uint64_t config, bool user_only) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1; // Include threads created later
+    attr.exclude_kernel = user_only;
+    attr.exclude_hv = user_only;
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+PerfCounters::PerfCounters() {
+    m_fds[CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true);
+    m_fds[INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, true);
+    m_fds[LLC_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, true);
+    m_fds[CONTEXT_SWITCHES] = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, false);
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : m_fds)
+        if (fd >= 0) close(fd);
+}
+
+const char* PerfCounters::Name(Event event) {
+    switch (event) {
+        case CYCLES: return "cycles";
+        case INSTRUCTIONS: return "instructions";
+        case LLC_MISSES: return "llc_misses";
+        case CONTEXT_SWITCHES: return "ctx_switches";
+        default: return "?";
+    }
+}
+
+void PerfCounters::Start() {
+    for (int fd : m_fds) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void PerfCounters::Stop() {
+    for (int fd : m_fds)
+        if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+uint64_t PerfCounters::Value(Event event) const {
+    uint64_t value = 0;
+    if (m_fds[event] < 0 || read(m_fds[event], &value, sizeof(value)) != sizeof(value)) return 0;
+    return value;
+}
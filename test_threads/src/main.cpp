@@ -1,12 +1,17 @@
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
-#include <vector>
+#include <memory>
 
 #include <args.hpp>
 #include "cli.h"
 
 #include "par_sum.h"
+#include "sweep.h"
 #include "Core.h"
+#include "LockProfile.h"
+#include "Numa.h"
+#include "ThreadPool.h"
 #include "Timer.h"
 
 void print_array(int *arr, int size);
@@ -18,22 +23,49 @@ int main(int argc, char const *argv[]) {
     Timer::Start();
     Core::Init();
 
-    std::vector<int> nums(cli::size);
+    if (cli::sweep) {
+        std::cout << "avail threads: " << Core::Count() << std::endl;
+        sweep(cli::size, cli::max, cli::num_threads, std::max(cli::repeat, 3), cli::placement);
+        return 0;
+    }
+
+    // Workers are started up front (and not timed) when reusing a pool
+    std::unique_ptr<ThreadPool> pool;
+    if (cli::pool) {
+        if (cli::placement) pool.reset(new ThreadPool(cli::num_threads, (Placement)(cli::placement-1)));
+        else pool.reset(new ThreadPool(cli::num_threads));
+    }
+
+    NumaArray<int> nums(cli::size);
+    if (pool) {
+        // Place each worker's part of the array on its NUMA node before filling it
+        nums.Distribute(*pool);
+        nums.FirstTouch(*pool, 0);
+    }
     for (int i = 0; i < cli::size; ++i)
         nums[i] = rand() % (cli::max + 1);
 
-    if (cli::verbose) print_array(&nums[0], cli::size);
+    if (cli::verbose) print_array(nums.Data(), cli::size);
 
-    long sum;
+    long sum = 0;
 
     std::cout << "avail threads: " << Core::Count() << std::endl;
+    std::cout << "numa nodes: " << Core::NumNodes() << std::endl;
 
     Timer::Start();
-    sum = par_sum(&nums[0], cli::size, cli::num_threads);
+    for (int r = 0; r < cli::repeat; ++r)
+        sum = pool ? par_sum(nums.Data(), cli::size, *pool) : par_sum(nums.Data(), cli::size, cli::num_threads);
     double s = Timer::EllapsedSec();
 
     std::cout << sum << std::endl;
     std::cout << "\ntime: " << (s*1000) << "ms" << std::endl;
+    if (cli::repeat > 1)
+        std::cout << "time per sum: " << (s*1000/cli::repeat) << "ms" << std::endl;
+
+#ifdef LIBTHREADING_LOCK_PROFILING
+    std::cout << std::endl;
+    LockRegistry::Report(std::cout);
+#endif
 
     return 0;
 }
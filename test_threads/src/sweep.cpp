@@ -0,0 +1,100 @@
+#include "sweep.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "par_sum.h"
+#include "Core.h"
+#include "Numa.h"
+#include "PerfCounters.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+static const PerfCounters::Event s_events[] = {
+    PerfCounters::CYCLES, PerfCounters::INSTRUCTIONS, PerfCounters::LLC_MISSES, PerfCounters::CONTEXT_SWITCHES
+};
+
+static std::vector<int> sweep_sizes(int max_size) {
+    std::vector<int> sizes;
+    for (long size = 10000; size < max_size; size *= 10)
+        sizes.push_back(size);
+    sizes.push_back(max_size);
+    return sizes;
+}
+
+static std::vector<int> sweep_threads(int max_threads) {
+    std::vector<int> counts;
+    for (int n = 1; n < max_threads; n *= 2)
+        counts.push_back(n);
+    counts.push_back(max_threads);
+    return counts;
+}
+
+// Prints a per trial counter value, or n/a
+static void print_counter(const PerfCounters& counters, PerfCounters::Event event, uint64_t total, int trials) {
+    std::cout << std::setw(14);
+    if (counters.Available(event)) std::cout << total / trials;
+    else std::cout << "n/a";
+}
+
+void sweep(int max_size, int max_value, int max_threads, int trials, int placement) {
+    std::cout << "\nsize\tthreads" << std::setw(12) << "median_ms" << std::setw(10) << "speedup"
+        << std::setw(12) << "efficiency" << std::setw(10) << "GB/s" << std::setw(8) << "IPC";
+    for (PerfCounters::Event event : s_events)
+        std::cout << std::setw(14) << PerfCounters::Name(event);
+    std::cout << std::endl;
+
+    for (int size : sweep_sizes(max_size)) {
+        NumaArray<int> nums(size);
+        for (int i = 0; i < size; ++i)
+            nums[i] = rand() % (max_value + 1);
+
+        double baseline = 0;
+        for (int n : sweep_threads(max_threads)) {
+            // Counters first, so they inherit into the pool's workers
+            PerfCounters counters;
+            std::unique_ptr<ThreadPool> pool;
+            if (placement) pool.reset(new ThreadPool(n, (Placement)(placement-1)));
+            else pool.reset(new ThreadPool(n));
+
+            par_sum(nums.Data(), size, *pool); // Warm up the workers and caches
+
+            std::vector<double> times;
+            uint64_t totals[PerfCounters::NUM_EVENTS] = {};
+            for (int t = 0; t < trials; ++t) {
+                counters.Start();
+                Timer::Start();
+                par_sum(nums.Data(), size, *pool);
+                times.push_back(Timer::EllapsedSec());
+                counters.Stop();
+
+                for (PerfCounters::Event event : s_events)
+                    totals[event] += counters.Value(event);
+            }
+
+            std::sort(times.begin(), times.end());
+            double median = times[times.size()/2];
+            if (n == 1) baseline = median;
+            double speedup = baseline / median;
+
+            std::cout << size << "\t" << n << std::fixed << std::setprecision(3)
+                << std::setw(12) << median*1000 << std::setw(10) << speedup
+                << std::setw(12) << speedup / n << std::setw(10) << (size*sizeof(int)) / median / 1e9;
+
+            std::cout << std::setw(8);
+            if (counters.Available(PerfCounters::CYCLES) && counters.Available(PerfCounters::INSTRUCTIONS) && totals[PerfCounters::CYCLES])
+                std::cout << (double)totals[PerfCounters::INSTRUCTIONS] / totals[PerfCounters::CYCLES];
+            else
+                std::cout << "n/a";
+            std::cout << std::defaultfloat;
+
+            for (PerfCounters::Event event : s_events)
+                print_counter(counters, event, totals[event], trials);
+            std::cout << std::endl;
+        }
+    }
+}